@@ -1,67 +1,104 @@
 #ifndef QMLPROPERTYOBSERVER_HPP
 #define QMLPROPERTYOBSERVER_HPP
 
-#include <QObject>
-#include <QQmlProperty>
+#include <QHash>
+#include <QList>
 #include <QMetaProperty>
+#include <QObject>
+#include <QVariant>
 #include <functional>
-#include <memory>
+#include <vector>
+
+#include "logging.h"
 
+// One observer for every watched property. Each watch connects the
+// property's NOTIFY signal to a virtual slot of this object; qt_metacall
+// maps the slot number straight to the pre-resolved QMetaProperty and
+// property ID, so a change costs an index lookup and a read through the
+// cached property index, with no string work and no QObject per watch.
+//
+// No Q_OBJECT on purpose: the virtual slots live past the end of QObject's
+// methods and are dispatched by the qt_metacall override below.
 class QmlPropertyObserver : public QObject {
-    Q_OBJECT
 public:
-    using Callback = std::function<void(QVariant newValue)>;
+    using Callback = std::function<void(quint16 id, const QVariant &value)>;
 
-    static QmlPropertyObserver* watch(const QQmlProperty& qmlProp, Callback cb, QObject* parent = nullptr) {
-        QObject* object = qmlProp.object();
-        const QString propName = qmlProp.name();
+    explicit QmlPropertyObserver(Callback cb, QObject* parent = nullptr)
+        : QObject(parent), m_callback(std::move(cb)) {}
 
-        if (!object || propName.isEmpty()) {
-            qDebug() << "QmlPropertyObserver: Invalid object or property name.";
-            return nullptr;
+    // Replaces any previous watch of id. Fails for properties without a
+    // NOTIFY signal.
+    bool watch(quint16 id, QObject* object, const QMetaProperty& property) {
+        if (!object || !property.hasNotifySignal()) {
+            qCDebug(lcBridge) << "QmlPropertyObserver: Property does not have a notify signal:" << property.name();
+            return false;
         }
+        unwatch(id);
 
-        const QMetaObject* meta = object->metaObject();
-        int index = meta->indexOfProperty(propName.toUtf8().constData());
-        if (index == -1) {
-            qDebug() << "QmlPropertyObserver: Property not found in object meta-object.";
-            return nullptr;
+        int slot;
+        if (!m_freeSlots.isEmpty()) {
+            slot = m_freeSlots.takeLast();
+        } else {
+            slot = int(m_watches.size());
+            m_watches.emplace_back();
         }
 
-        QMetaProperty prop = meta->property(index);
-        if (!prop.hasNotifySignal()) {
-            qDebug() << "QmlPropertyObserver: Property does not have a notify signal.";
-            return nullptr;
+        Watch& w = m_watches[size_t(slot)];
+        w.connection = QMetaObject::connect(object, property.notifySignalIndex(), this,
+                                            QObject::staticMetaObject.methodCount() + slot,
+                                            Qt::DirectConnection);
+        if (!w.connection) {
+            qCDebug(lcBridge) << "QmlPropertyObserver: Could not connect the notify signal of:" << property.name();
+            m_freeSlots.append(slot);
+            return false;
         }
-
-        QmlPropertyObserver* observer = new QmlPropertyObserver(object, propName, std::move(cb), parent);
-
-        QMetaMethod notifySignal = prop.notifySignal();
-        QMetaMethod targetSlot = observer->metaObject()->method(observer->metaObject()->indexOfSlot("onPropertyChanged()"));
-
-        // Store the connection so it can be managed later if needed
-        observer->m_connection = QObject::connect(object, notifySignal, observer, targetSlot);
-        return observer;
+        w.object = object;
+        w.property = property;
+        w.id = id;
+        m_slots.insert(id, slot);
+        return true;
     }
 
-    // Expose the connection for external management if needed
-    QMetaObject::Connection connection() const { return m_connection; }
+    void unwatch(quint16 id) {
+        const auto it = m_slots.constFind(id);
+        if (it == m_slots.constEnd())
+            return;
+        const int slot = it.value();
+        m_slots.erase(it);
+        Watch& w = m_watches[size_t(slot)];
+        QObject::disconnect(w.connection);
+        w = Watch();
+        m_freeSlots.append(slot);
+    }
 
-private:
-    QmlPropertyObserver(QObject* obj, QString propName, Callback cb, QObject* parent)
-        : QObject(parent), m_object(obj), m_propName(std::move(propName)), m_callback(std::move(cb)) {}
+    bool isWatching(quint16 id) const { return m_slots.contains(id); }
+    qsizetype count() const { return m_slots.size(); }
 
-private slots:
-    void onPropertyChanged() {
-        QVariant val = QQmlProperty::read(m_object, m_propName);
-        if (m_callback) m_callback(val);
+    int qt_metacall(QMetaObject::Call call, int id, void** argv) override {
+        id = QObject::qt_metacall(call, id, argv);
+        if (id < 0 || call != QMetaObject::InvokeMetaMethod)
+            return id;
+        if (size_t(id) < m_watches.size()) {
+            const Watch& w = m_watches[size_t(id)];
+            if (w.object && m_callback)
+                m_callback(w.id, w.property.read(w.object));
+        }
+        return -1;
     }
 
 private:
-    QObject* m_object;
-    QString m_propName;
+    struct Watch {
+        QObject* object = nullptr;
+        QMetaProperty property;
+        quint16 id = 0;
+        QMetaObject::Connection connection;
+    };
+
     Callback m_callback;
-    QMetaObject::Connection m_connection;
+    // Indexed by slot number; unwatched slots are reused
+    std::vector<Watch> m_watches;
+    QList<int> m_freeSlots;
+    QHash<quint16, int> m_slots;
 };
 
 #endif // QMLPROPERTYOBSERVER_HPP
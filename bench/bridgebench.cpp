@@ -0,0 +1,251 @@
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "genericqmlbridge.h"
+#include "slipprocessor.h"
+
+namespace {
+
+// A bridge loaded with a generated scene: an Item with `count` real
+// properties p0..p<count-1>, all watchable and packable
+class SyntheticScene
+{
+public:
+    explicit SyntheticScene(int count)
+    {
+        QString qml = QStringLiteral("import QtQuick\n\nItem {\n");
+        for (int i = 0; i < count; ++i)
+            qml += QStringLiteral("    property real p%1: 0\n").arg(i);
+        qml += QStringLiteral("}\n");
+
+        const QString path = m_dir.filePath(QStringLiteral("Scene.qml"));
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(qml.toUtf8()) < 0)
+            return;
+        file.close();
+
+        m_loaded = m_bridge.loadQML(path);
+        for (int i = 0; m_loaded && i < count; ++i)
+            m_ids.append(m_bridge.propertyId(QStringLiteral("p%1").arg(i)));
+    }
+
+    bool isLoaded() const { return m_loaded; }
+    GenericQMLBridge &bridge() { return m_bridge; }
+    const QList<int> &ids() const { return m_ids; }
+
+private:
+    QTemporaryDir m_dir;
+    GenericQMLBridge m_bridge;
+    QList<int> m_ids;
+    bool m_loaded = false;
+};
+
+QByteArray commandPacket(quint8 command, const QCborValue &payload)
+{
+    return QByteArray(1, char(command)) + payload.toCbor();
+}
+
+QByteArray setPacket(const QList<int> &ids, double value)
+{
+    QCborMap map;
+    for (int id : ids)
+        map.insert(qint64(id), value);
+    return commandPacket(GenericQMLBridge::CMD_SET_PROPERTY, map);
+}
+
+QByteArray watchPacket(const QList<int> &ids)
+{
+    QCborArray array;
+    for (int id : ids)
+        array.append(qint64(id));
+    return commandPacket(GenericQMLBridge::CMD_WATCH_PROPERTY, array);
+}
+
+// Runs the event loop until done() holds; false after timeoutMs
+template <typename Predicate>
+bool pumpUntil(Predicate done, int timeoutMs = 5000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > timeoutMs)
+            return false;
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+// Alternating between two values keeps every write a real change
+void runSetLoop(benchmark::State &state, GenericQMLBridge &bridge,
+                const QByteArray &first, const QByteArray &second)
+{
+    bool flip = false;
+    for (auto _ : state) {
+        bridge.processCommand(flip ? second : first);
+        flip = !flip;
+    }
+}
+
+void BM_SetPropertySingle(benchmark::State &state)
+{
+    SyntheticScene scene(int(state.range(0)));
+    if (!scene.isLoaded()) {
+        state.SkipWithError("could not load the synthetic scene");
+        return;
+    }
+    const QList<int> target = { scene.ids().last() };
+    runSetLoop(state, scene.bridge(), setPacket(target, 1.0), setPacket(target, 2.0));
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_SetPropertyBatch(benchmark::State &state)
+{
+    SyntheticScene scene(int(state.range(0)));
+    if (!scene.isLoaded()) {
+        state.SkipWithError("could not load the synthetic scene");
+        return;
+    }
+    runSetLoop(state, scene.bridge(), setPacket(scene.ids(), 1.0), setPacket(scene.ids(), 2.0));
+    state.SetItemsProcessed(state.iterations() * scene.ids().size());
+}
+
+void BM_SetPropertyPacked(benchmark::State &state)
+{
+    SyntheticScene scene(int(state.range(0)));
+    if (!scene.isLoaded()) {
+        state.SkipWithError("could not load the synthetic scene");
+        return;
+    }
+    QCborMap options;
+    options.insert(QStringLiteral("wide"), true);
+    scene.bridge().processCommand(commandPacket(GenericQMLBridge::CMD_SET_OPTIONS, options));
+
+    // Two-byte big-endian IDs followed by little-endian f64 values (QML real)
+    auto packedPacket = [&scene](double value) {
+        QByteArray packet(1, char(GenericQMLBridge::CMD_SET_PROPERTY_PACKED));
+        for (int id : scene.ids()) {
+            char record[10];
+            qToBigEndian<quint16>(quint16(id), record);
+            qToLittleEndian<double>(value, record + 2);
+            packet.append(record, sizeof(record));
+        }
+        return packet;
+    };
+    runSetLoop(state, scene.bridge(), packedPacket(1.0), packedPacket(2.0));
+    state.SetItemsProcessed(state.iterations() * scene.ids().size());
+}
+
+void BM_WatchFanout(benchmark::State &state)
+{
+    // One property change per iteration, delivered over a local socket to
+    // every watching client: publish, encode, I/O thread and socket write
+    SyntheticScene scene(64);
+    if (!scene.isLoaded()) {
+        state.SkipWithError("could not load the synthetic scene");
+        return;
+    }
+    GenericQMLBridge &bridge = scene.bridge();
+    const QString serverName = QStringLiteral("qml-remoteserver-bench-%1").arg(QCoreApplication::applicationPid());
+    if (!bridge.setupLocal(serverName)) {
+        state.SkipWithError("could not listen on a local socket");
+        return;
+    }
+
+    const int clients = int(state.range(0));
+    std::vector<std::unique_ptr<QLocalSocket>> sockets;
+    for (int client = 0; client < clients; ++client) {
+        sockets.push_back(std::make_unique<QLocalSocket>());
+        sockets.back()->connectToServer(serverName);
+    }
+    if (!pumpUntil([&bridge, clients] { return bridge.connectedClients() == clients; })) {
+        state.SkipWithError("clients did not connect");
+        return;
+    }
+
+    // The RESP_OPTIONS reply to the trailing SET_OPTIONS shows the watch
+    // is in place
+    const QList<int> target = { scene.ids().first() };
+    const QByteArray subscribe = SlipProcessor::encodeSlip(watchPacket(target))
+            + SlipProcessor::encodeSlip(commandPacket(GenericQMLBridge::CMD_SET_OPTIONS, QCborMap()));
+    for (const auto &socket : sockets)
+        socket->write(subscribe);
+    auto allReceived = [&sockets] {
+        return std::all_of(sockets.cbegin(), sockets.cend(),
+                           [](const auto &socket) { return socket->bytesAvailable() > 0; });
+    };
+    if (!pumpUntil(allReceived)) {
+        state.SkipWithError("clients did not subscribe");
+        return;
+    }
+    for (const auto &socket : sockets)
+        socket->readAll();
+
+    const QByteArray first = setPacket(target, 1.0);
+    const QByteArray second = setPacket(target, 2.0);
+    bool flip = false;
+    for (auto _ : state) {
+        bridge.processCommand(flip ? second : first);
+        flip = !flip;
+        // Runs the publisher's flush timer and waits for every delivery
+        if (!pumpUntil(allReceived)) {
+            state.SkipWithError("a client missed a change");
+            break;
+        }
+        for (const auto &socket : sockets)
+            socket->readAll();
+    }
+    state.SetItemsProcessed(state.iterations() * clients);
+}
+
+void BM_PropertyListBuild(benchmark::State &state)
+{
+    // Rediscovery drops the cached list, so every request rebuilds it.
+    // Only the rebuild is timed.
+    SyntheticScene scene(int(state.range(0)));
+    if (!scene.isLoaded()) {
+        state.SkipWithError("could not load the synthetic scene");
+        return;
+    }
+    const QByteArray request(1, char(GenericQMLBridge::CMD_GET_PROPERTY_LIST));
+    for (auto _ : state) {
+        state.PauseTiming();
+        scene.bridge().discoverProperties();
+        state.ResumeTiming();
+        scene.bridge().processCommand(request);
+    }
+}
+
+void BM_PropertyListCached(benchmark::State &state)
+{
+    SyntheticScene scene(int(state.range(0)));
+    if (!scene.isLoaded()) {
+        state.SkipWithError("could not load the synthetic scene");
+        return;
+    }
+    const QByteArray request(1, char(GenericQMLBridge::CMD_GET_PROPERTY_LIST));
+    scene.bridge().processCommand(request);
+    for (auto _ : state)
+        scene.bridge().processCommand(request);
+}
+
+} // namespace
+
+BENCHMARK(BM_SetPropertySingle)->RangeMultiplier(8)->Range(16, 1024);
+BENCHMARK(BM_SetPropertyBatch)->RangeMultiplier(8)->Range(16, 1024);
+BENCHMARK(BM_SetPropertyPacked)->RangeMultiplier(8)->Range(16, 1024);
+BENCHMARK(BM_WatchFanout)->RangeMultiplier(4)->Range(1, 256);
+BENCHMARK(BM_PropertyListBuild)->RangeMultiplier(8)->Range(16, 1024);
+BENCHMARK(BM_PropertyListCached)->RangeMultiplier(8)->Range(16, 1024);
@@ -0,0 +1,113 @@
+#include <QByteArray>
+#include <QCborMap>
+#include <QCborValue>
+
+#include <benchmark/benchmark.h>
+
+#include "slipprocessor.h"
+
+namespace {
+
+// A RESP_PROPERTY_CHANGE frame of doubles: mostly plain bytes, with the
+// occasional END/ESC coming from the values
+QByteArray realisticPayload(qsizetype size)
+{
+    // Every entry takes at least 10 bytes
+    QCborMap changes;
+    for (qint64 id = 0; id < size / 10 + 1; ++id)
+        changes.insert(id, 20.0 + double(id % 97) * 0.173);
+    const QByteArray packet = QByteArray(1, char(0x82)) + changes.toCborValue().toCbor();
+    return packet.left(size);
+}
+
+// Worst case: every other byte has to be escaped
+QByteArray escapeHeavyPayload(qsizetype size)
+{
+    static const char pattern[] = { char(0xC0), 'a', char(0xDB), 'b' };
+    QByteArray packet(size, Qt::Uninitialized);
+    for (qsizetype i = 0; i < size; ++i)
+        packet[i] = pattern[i % 4];
+    return packet;
+}
+
+// Back-to-back SLIP frames adding up to about 64 KiB, as read from a link
+QByteArray encodedStream(const QByteArray &payload)
+{
+    const QByteArray frame = SlipProcessor::encodeSlip(payload);
+    QByteArray stream;
+    while (stream.size() < 64 * 1024)
+        stream += frame;
+    return stream;
+}
+
+template <typename PayloadFn>
+void BM_SlipEncode(benchmark::State &state, PayloadFn payloadFn)
+{
+    const QByteArray payload = payloadFn(state.range(0));
+    for (auto _ : state) {
+        QByteArray encoded = SlipProcessor::encodeSlip(payload);
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+template <typename PayloadFn>
+void BM_SlipAppend(benchmark::State &state, PayloadFn payloadFn)
+{
+    // Reused output buffer, as on the notification path
+    const QByteArray payload = payloadFn(state.range(0));
+    QByteArray encoded;
+    for (auto _ : state) {
+        encoded.resize(0);
+        SlipProcessor::appendSlip(payload, encoded);
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+template <typename PayloadFn>
+void BM_SlipOnDataReceived(benchmark::State &state, PayloadFn payloadFn)
+{
+    const QByteArray stream = encodedStream(payloadFn(state.range(0)));
+    SlipProcessor processor;
+    qsizetype frames = 0;
+    QObject::connect(&processor, &SlipProcessor::packetReceived, &processor, [&frames](const QByteArray &) {
+        ++frames;
+    });
+    for (auto _ : state)
+        processor.onDataReceived(stream);
+    benchmark::DoNotOptimize(frames);
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+
+template <typename PayloadFn>
+void BM_SlipDecode(benchmark::State &state, PayloadFn payloadFn)
+{
+    // Fed in 512-byte reads, so frames regularly straddle two chunks
+    const QByteArray stream = encodedStream(payloadFn(state.range(0)));
+    constexpr qsizetype chunkSize = 512;
+    SlipProcessor processor;
+    qsizetype bytes = 0;
+    for (auto _ : state) {
+        for (qsizetype offset = 0; offset < stream.size(); offset += chunkSize) {
+            const QByteArrayView chunk(stream.constData() + offset,
+                                       qMin(chunkSize, stream.size() - offset));
+            processor.decode(chunk, [&bytes](QByteArrayView frame) {
+                bytes += frame.size();
+            });
+        }
+    }
+    benchmark::DoNotOptimize(bytes);
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_SlipEncode, realistic, realisticPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipEncode, escape_heavy, escapeHeavyPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipAppend, realistic, realisticPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipAppend, escape_heavy, escapeHeavyPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipOnDataReceived, realistic, realisticPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipOnDataReceived, escape_heavy, escapeHeavyPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipDecode, realistic, realisticPayload)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_SlipDecode, escape_heavy, escapeHeavyPayload)->Range(64, 16 << 10);
@@ -0,0 +1,150 @@
+#ifndef CBORVALUEREADER_HPP
+#define CBORVALUEREADER_HPP
+
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QMetaType>
+#include <QString>
+#include <QVariant>
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// Pull-parsing helpers on top of QCborStreamReader. Values are read in
+// place from the frame and built directly as the target metatype, without
+// a QCborValue tree in between.
+class CborValueReader {
+public:
+    // Reads a map key: integer keys go to id, text keys to name.
+    // Returns false for other key types. Advances past the key.
+    static bool readKey(QCborStreamReader &reader, qint64 *id, QString *name) {
+        if (reader.isInteger()) {
+            *id = reader.toInteger();
+            name->clear();
+            reader.next();
+            return true;
+        }
+        if (reader.isString()) {
+            *id = -1;
+            *name = readString(reader);
+            return true;
+        }
+        reader.next();
+        return false;
+    }
+
+    // Reads the current item as target. An invalid target keeps the natural
+    // CBOR type. Advances past the item. A value that does not convert
+    // comes back as a null variant of target and sets *ok to false.
+    static QVariant readValue(QCborStreamReader &reader, QMetaType target = QMetaType(), bool *ok = nullptr) {
+        if (ok)
+            *ok = true;
+        if (reader.isUnsignedInteger()) {
+            const quint64 value = reader.toUnsignedInteger();
+            reader.next();
+            return numberAs(value, target, ok);
+        }
+        if (reader.isNegativeInteger() || reader.isInteger()) {
+            const qint64 value = reader.toInteger();
+            reader.next();
+            return numberAs(value, target, ok);
+        }
+        if (reader.isDouble() || reader.isFloat() || reader.isFloat16()) {
+            const double value = reader.isDouble() ? reader.toDouble()
+                               : reader.isFloat() ? double(reader.toFloat())
+                               : double(reader.toFloat16());
+            reader.next();
+            return numberAs(value, target, ok);
+        }
+        if (reader.isBool()) {
+            const bool value = reader.toBool();
+            reader.next();
+            return numberAs(value, target, ok);
+        }
+        if (reader.isString())
+            return convertTo(QVariant(readString(reader)), target, ok);
+        if (reader.isNull() || reader.isUndefined()) {
+            reader.next();
+            return isConcrete(target) ? QVariant(target) : QVariant();
+        }
+
+        // Arrays, maps, byte strings and tags are rare on the hot path
+        return convertTo(QCborValue::fromCbor(reader).toVariant(), target, ok);
+    }
+
+    static QString readString(QCborStreamReader &reader) {
+        QString result;
+        auto chunk = reader.readString();
+        while (chunk.status == QCborStreamReader::Ok) {
+            result += chunk.data;
+            chunk = reader.readString();
+        }
+        return result;
+    }
+
+    // Converts a number to target with the same checks as readValue().
+    // Also used for numbers that do not come from CBOR.
+    template <typename T>
+    static QVariant numberAs(T value, QMetaType target, bool *ok) {
+        switch (target.id()) {
+        case QMetaType::Bool:      return QVariant(value != T(0));
+        case QMetaType::Int:       return narrowed<int>(value, ok);
+        case QMetaType::UInt:      return narrowed<uint>(value, ok);
+        case QMetaType::LongLong:  return narrowed<qint64>(value, ok);
+        case QMetaType::ULongLong: return narrowed<quint64>(value, ok);
+        case QMetaType::Float:
+            // NaN and infinities carry over; finite values past float's
+            // range do not
+            if (std::isfinite(double(value))
+                    && std::abs(double(value)) > double(std::numeric_limits<float>::max()))
+                return rejected(target, ok);
+            return QVariant(float(value));
+        case QMetaType::Double:    return QVariant(double(value));
+        default:
+            return convertTo(QVariant::fromValue(value), target, ok);
+        }
+    }
+
+private:
+    static bool isConcrete(QMetaType target) {
+        return target.isValid() && target.id() != QMetaType::QVariant;
+    }
+
+    // Casting a NaN, an infinity or an out-of-range number to an integer
+    // type is undefined or wraps, so such values do not convert
+    template <typename To, typename T>
+    static QVariant narrowed(T value, bool *ok) {
+        using Limits = std::numeric_limits<To>;
+        bool fits;
+        if constexpr (std::is_floating_point_v<T>) {
+            // Bounds are exclusive and one past the limit, so they stay
+            // exact as doubles and allow truncating fractions
+            fits = std::isfinite(value) && value > double(Limits::min()) - 1.0
+                    && value < double(Limits::max()) + 1.0;
+        } else if constexpr (std::is_signed_v<T>) {
+            fits = value < 0 ? std::is_signed_v<To> && qint64(value) >= qint64(Limits::min())
+                             : quint64(value) <= quint64(Limits::max());
+        } else {
+            fits = quint64(value) <= quint64(Limits::max());
+        }
+        if (!fits)
+            return rejected(QMetaType::fromType<To>(), ok);
+        return QVariant::fromValue(To(value));
+    }
+
+    static QVariant rejected(QMetaType target, bool *ok) {
+        if (ok)
+            *ok = false;
+        return QVariant(target);
+    }
+
+    static QVariant convertTo(QVariant value, QMetaType target, bool *ok) {
+        // A failed convert() still leaves a null variant of target
+        if (isConcrete(target) && value.metaType() != target && !value.convert(target) && ok)
+            *ok = false;
+        return value;
+    }
+};
+
+#endif  // CBORVALUEREADER_HPP
@@ -51,6 +51,19 @@ public:
         return QVariant(value);
     }
 
+    QVariant decodeDouble(const QByteArray &data, int offset = 0) const {
+        if (data.size() < offset + 8) {
+            return QVariant();
+        }
+        double value;
+        if (m_endianess == LittleEndian) {
+            value = qFromLittleEndian<double>(reinterpret_cast<const uchar *>(data.constData() + offset));
+        } else {
+            value = qFromBigEndian<double>(reinterpret_cast<const uchar *>(data.constData() + offset));
+        }
+        return QVariant(value);
+    }
+
     QVariant decodeBool(const QByteArray &data, int offset = 0) const {
         if (data.size() < offset + 1) {
             return QVariant();
@@ -0,0 +1,54 @@
+#ifndef DATAENCODER_HPP
+#define DATAENCODER_HPP
+
+#include <QByteArray>
+#include <QtEndian>
+
+#include "datadecoder.hpp"
+
+// Counterpart of DataDecoder: appends fixed-width, endian-aware values
+class DataEncoder {
+public:
+    using Endianess = DataDecoder::Endianess;
+
+    void encodeInt32(QByteArray &data, int32_t value) const {
+        append(data, value);
+    }
+
+    void encodeFloat(QByteArray &data, float value) const {
+        append(data, value);
+    }
+
+    void encodeDouble(QByteArray &data, double value) const {
+        append(data, value);
+    }
+
+    void encodeBool(QByteArray &data, bool value) const {
+        data.append(static_cast<char>(value ? 1 : 0));
+    }
+
+    void setEndianess(Endianess endianess) {
+        m_endianess = endianess;
+    }
+
+    Endianess endianess() const {
+        return m_endianess;
+    }
+
+private:
+    template <typename T>
+    void append(QByteArray &data, T value) const {
+        const qsizetype offset = data.size();
+        data.resize(offset + qsizetype(sizeof(T)));
+        uchar *dst = reinterpret_cast<uchar *>(data.data() + offset);
+        if (m_endianess == DataDecoder::LittleEndian) {
+            qToLittleEndian<T>(value, dst);
+        } else {
+            qToBigEndian<T>(value, dst);
+        }
+    }
+
+    Endianess m_endianess = DataDecoder::LittleEndian;
+};
+
+#endif  // DATAENCODER_HPP
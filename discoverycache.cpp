@@ -0,0 +1,121 @@
+#include "discoverycache.h"
+
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+
+quint64 DiscoveryCache::sourceHash(const QString &qmlFile, const QString &sourceRoot)
+{
+    // Only an explicit root is walked recursively: the file's own directory
+    // may be $HOME or /, and the hash runs on every start
+    const QFileInfo main(qmlFile);
+    const QDir root = sourceRoot.isEmpty() ? main.absoluteDir() : QDir(sourceRoot);
+
+    QStringList files;
+    QDirIterator it(root.absolutePath(), { QStringLiteral("*.qml"), QStringLiteral("*.js"),
+                                           QStringLiteral("*.mjs"), QStringLiteral("qmldir") },
+                    QDir::Files, sourceRoot.isEmpty() ? QDirIterator::NoIteratorFlags
+                                                      : QDirIterator::Subdirectories);
+    while (it.hasNext())
+        files.append(it.next());
+    std::sort(files.begin(), files.end());
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(FormatVersion));
+    hash.addData(qVersion());
+    hash.addData(main.fileName().toUtf8());
+    for (const QString &file : std::as_const(files)) {
+        QFile source(file);
+        if (!source.open(QIODevice::ReadOnly))
+            continue;
+        hash.addData(QByteArray(1, '\0'));
+        hash.addData(root.relativeFilePath(file).toUtf8());
+        hash.addData(QByteArray(1, '\0'));
+        hash.addData(&source);
+    }
+    return qFromBigEndian<quint64>(hash.result().constData());
+}
+
+bool DiscoveryCache::load(const QString &path, quint64 hash)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QCborMap root = QCborValue::fromCbor(file.readAll()).toMap();
+    if (root.value(QStringLiteral("version")).toInteger() != FormatVersion
+            || quint64(root.value(QStringLiteral("hash")).toInteger()) != hash)
+        return false;
+
+    properties.clear();
+    methods.clear();
+    for (const QCborValue &value : root.value(QStringLiteral("properties")).toArray()) {
+        // [id, name, path, index, type]
+        const QCborArray entry = value.toArray();
+        Property prop;
+        prop.id = quint16(entry.at(0).toInteger());
+        prop.name = entry.at(1).toString();
+        prop.path = entry.at(2).toString();
+        prop.propertyIndex = int(entry.at(3).toInteger(-1));
+        prop.typeName = entry.at(4).toString().toUtf8();
+        if (entry.size() != 5 || prop.name.isEmpty() || prop.propertyIndex < 0)
+            return false;
+        properties.append(prop);
+    }
+    for (const QCborValue &value : root.value(QStringLiteral("methods")).toArray()) {
+        // [id, name, path, index, signature, [parameter types]]
+        const QCborArray entry = value.toArray();
+        Method method;
+        method.id = quint16(entry.at(0).toInteger());
+        method.name = entry.at(1).toString();
+        method.path = entry.at(2).toString();
+        method.methodIndex = int(entry.at(3).toInteger(-1));
+        method.signature = entry.at(4).toString().toUtf8();
+        for (const QCborValue &type : entry.at(5).toArray())
+            method.parameterTypeNames.append(type.toString().toUtf8());
+        if (entry.size() != 6 || method.name.isEmpty() || method.methodIndex < 0)
+            return false;
+        methods.append(method);
+    }
+    return true;
+}
+
+bool DiscoveryCache::save(const QString &path, quint64 hash) const
+{
+    QCborArray props;
+    for (const Property &prop : properties) {
+        props.append(QCborArray{ prop.id, prop.name, prop.path, prop.propertyIndex,
+                                 QString::fromUtf8(prop.typeName) });
+    }
+    QCborArray meths;
+    for (const Method &method : methods) {
+        QCborArray types;
+        for (const QByteArray &type : method.parameterTypeNames)
+            types.append(QString::fromUtf8(type));
+        meths.append(QCborArray{ method.id, method.name, method.path, method.methodIndex,
+                                 QString::fromUtf8(method.signature), types });
+    }
+    QCborMap root;
+    root[QStringLiteral("version")] = FormatVersion;
+    root[QStringLiteral("hash")] = qint64(hash);
+    root[QStringLiteral("properties")] = props;
+    root[QStringLiteral("methods")] = meths;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write discovery cache" << path << ":" << file.errorString();
+        return false;
+    }
+    file.write(root.toCborValue().toCbor());
+    return file.commit();
+}
@@ -0,0 +1,46 @@
+#ifndef DISCOVERYCACHE_H
+#define DISCOVERYCACHE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// On-disk copy of the discovered schema: property and method IDs, names,
+// the objectName path of their object and their metaobject index. It is
+// keyed by a hash of the QML sources, so an unchanged dashboard starts
+// from the cache instead of scanning the object tree.
+class DiscoveryCache
+{
+public:
+    static constexpr int FormatVersion = 1;
+
+    struct Property {
+        quint16 id = 0;
+        QString name;
+        QString path;          // objectName chain from the root, "" for the root
+        int propertyIndex = -1;
+        QByteArray typeName;
+    };
+    struct Method {
+        quint16 id = 0;
+        QString name;
+        QString path;
+        int methodIndex = -1;
+        QByteArray signature;  // checked when the method is resolved
+        QList<QByteArray> parameterTypeNames;
+    };
+
+    // Hash of every .qml, .js, .mjs and qmldir file next to qmlFile, or
+    // anywhere below sourceRoot if one is given, the Qt version and the
+    // cache format
+    static quint64 sourceHash(const QString &qmlFile, const QString &sourceRoot = QString());
+
+    // Fails if the file is missing, malformed or was written for another hash
+    bool load(const QString &path, quint64 hash);
+    bool save(const QString &path, quint64 hash) const;
+
+    QList<Property> properties;
+    QList<Method> methods;
+};
+
+#endif // DISCOVERYCACHE_H
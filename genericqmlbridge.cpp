@@ -1,66 +1,578 @@
 #include "genericqmlbridge.h"
 #include "slipprocessor.h"
 #include "datadecoder.hpp"
+#include "dataencoder.hpp"
+#include "cborvaluereader.hpp"
 #include "QmlPropertyObserver.hpp"
+#include "propertychangepublisher.h"
+#include "ioworker.h"
+#include "logging.h"
+#include "metricsserver.h"
+#include "discoverycache.h"
+#ifdef Q_OS_LINUX
+#include "shmtransport.h"
+#endif
 
 #include <QTimer>
 #include <QCborMap>
 #include <QCborValue>
 #include <QCborStreamWriter>
+#include <QCborStreamReader>
 #include <QCborArray>
 #include <QSet>
+#include <QVarLengthArray>
+#include <QQuickWindow>
+#include <QQuickItem>
+#include <QChildEvent>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <algorithm>
 
 GenericQMLBridge::GenericQMLBridge(QObject *parent)
     : QObject(parent)
     , m_engine(new QQmlApplicationEngine(this))
     , m_rootObject(nullptr)
-    , m_serialPort(nullptr)
-    , m_tcpServer(nullptr)
-    , m_heartbeatTimer(new QTimer(this))
-    , m_configuredBaudRate(115200)
-    , m_configuredTcpPort(0)
-    , m_slipProcessor(new SlipProcessor(this))
+    , m_ioWorker(new IoWorker)
+    , m_serialConnected(false)
+    , m_connectedClients(0)
+    , m_drainFallbackTimer(new QTimer(this))
+    , m_changePublisher(new PropertyChangePublisher(this))
+    , m_metrics(QMetaEnum::fromType<ProtocolCommand>())
+    , m_propertyObserver(new QmlPropertyObserver([this](quint16 id, const QVariant &value) {
+          m_valueCache.store(id, value);
+          if (m_subscribers.contains(id))
+              m_changePublisher->markDirty(id, value);
+      }, this))
+    , m_watchIntervalTimer(new QTimer(this))
+    , m_discoveryTimer(new QTimer(this))
 {
-    m_heartbeatTimer->setInterval(5000);
-    connect(m_heartbeatTimer, &QTimer::timeout, this, &GenericQMLBridge::checkConnections);
-    connect(m_slipProcessor, &SlipProcessor::packetReceived, this, &GenericQMLBridge::processCommand);
+    m_changePublisher->setSink([this](const QList<PropertyChangePublisher::Change> &changes) {
+        publishChanges(changes);
+    });
+
+    // Safety net in case a requested frame never comes
+    m_drainFallbackTimer->setSingleShot(true);
+    m_drainFallbackTimer->setInterval(50);
+    connect(m_drainFallbackTimer, &QTimer::timeout, this, &GenericQMLBridge::drainInbound);
+
+    m_watchClock.start();
+    m_watchIntervalTimer->setSingleShot(true);
+    connect(m_watchIntervalTimer, &QTimer::timeout, this, &GenericQMLBridge::flushPendingWatches);
+
+    // Objects are scanned once the event loop is back, after QML has
+    // finished setting them up
+    m_discoveryTimer->setSingleShot(true);
+    m_discoveryTimer->setInterval(0);
+    connect(m_discoveryTimer, &QTimer::timeout, this, &GenericQMLBridge::processDiscoveryChanges);
+
+    m_ioWorker->setHeartbeatPacket(QByteArray(1, static_cast<char>(CMD_HEARTBEAT)));
+    m_ioWorker->moveToThread(&m_ioThread);
+    connect(&m_ioThread, &QThread::finished, m_ioWorker, &QObject::deleteLater);
+    connect(m_ioWorker, &IoWorker::inboundReady, this, &GenericQMLBridge::scheduleInboundDrain);
+    connect(m_ioWorker, &IoWorker::serialConnectionStateChanged, this, [this](bool connected) {
+        m_serialConnected = connected;
+        emit serialConnectionStateChanged(connected);
+    });
+    connect(m_ioWorker, &IoWorker::connectedClientsChanged, this, [this](int count) {
+        m_connectedClients = count;
+        emit connectedClientsChanged(count);
+        emit tcpConnectionStateChanged(count > 0);
+    });
+    connect(m_ioWorker, &IoWorker::sessionCongestionChanged, this, [this](quint32 session, bool congested) {
+        // Only the collapse policy holds changes back in the bridge
+        if (m_sendQueuePolicy == IoWorker::CollapseLatest || !congested)
+            setSessionCongested(session, congested);
+    });
+    connect(m_ioWorker, &IoWorker::errorOccurred, this, &GenericQMLBridge::setLastError);
+    connect(m_ioWorker, &IoWorker::connectionLost, this, &GenericQMLBridge::connectionLost);
+    m_ioThread.setObjectName(QStringLiteral("qml-remoteserver-io"));
+    m_ioThread.start();
 }
 
-bool GenericQMLBridge::loadQML(const QString &qmlFile)
+static GenericQMLBridge::WireType wireTypeFor(QMetaType type)
 {
-    m_properties.clear();
-    m_methods.clear();
-    m_propertyIdMap.clear();
-    m_propertyNameMap.clear();
+    switch (type.id()) {
+    case QMetaType::Bool:
+        return GenericQMLBridge::WireBool;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+        return GenericQMLBridge::WireInt32;
+    case QMetaType::Float:
+        return GenericQMLBridge::WireFloat32;
+    case QMetaType::Double:
+        // QML's real; f32 would cut every value to float precision
+        return GenericQMLBridge::WireFloat64;
+    default:
+        return GenericQMLBridge::WireNone;
+    }
+}
 
-    m_engine->load(QUrl::fromLocalFile(qmlFile));
+static QString wireTypeName(GenericQMLBridge::WireType type)
+{
+    switch (type) {
+    case GenericQMLBridge::WireBool:    return QStringLiteral("bool");
+    case GenericQMLBridge::WireInt32:   return QStringLiteral("i32");
+    case GenericQMLBridge::WireFloat32: return QStringLiteral("f32");
+    case GenericQMLBridge::WireFloat64: return QStringLiteral("f64");
+    default:                            return QString();
+    }
+}
 
-    if (m_engine->rootObjects().isEmpty()) {
+// Children discovery descends into: the direct QObject children, plus the
+// visual children of an item, since Repeater delegates and Loader items
+// are not always QObject children of the item they are shown in
+static QObjectList discoveryChildren(QObject *obj)
+{
+    QObjectList children = obj->children();
+    if (auto *item = qobject_cast<QQuickItem *>(obj)) {
+        const QList<QQuickItem *> childItems = item->childItems();
+        for (QQuickItem *child : childItems) {
+            if (child->parent() != obj)
+                children.append(child);
+        }
+    }
+    return children;
+}
+
+static QString childPath(const QString &prefix, const QString &name)
+{
+    return prefix.isEmpty() ? name : prefix + QLatin1Char('.') + name;
+}
+
+bool GenericQMLBridge::loadQML(const QString &qmlFile)
+{
+    QObject *root = createScene(qmlFile);
+    if (!root) {
         qDebug() << "Error: Could not load" << qmlFile;
         return false;
     }
+    m_qmlFile = qmlFile;
+    attachScene(root);
 
-    m_rootObject = m_engine->rootObjects().first();
-    discoverProperties();
+    if (!m_discoveryCachePath.isEmpty())
+        m_sourceHash = DiscoveryCache::sourceHash(qmlFile, m_discoverySourceRoot);
+    if (!restoreDiscoveryCache())
+        discoverProperties();
+    if (m_hotReload)
+        watchQmlSources();
 
     qDebug() << "QML loaded successfully:" << qmlFile;
-    qDebug() << "Properties detected:" << m_properties.keys();
 
     return true;
 }
 
+QObject *GenericQMLBridge::createScene(const QString &qmlFile)
+{
+    // objectCreated reports the root of this load, or nullptr if it failed
+    const QUrl url = QUrl::fromLocalFile(qmlFile);
+    QObject *root = nullptr;
+    const QMetaObject::Connection created = connect(m_engine, &QQmlApplicationEngine::objectCreated, this,
+                                                    [&root, url](QObject *object, const QUrl &objectUrl) {
+        if (objectUrl == url)
+            root = object;
+    });
+    m_engine->load(url);
+    disconnect(created);
+    return root;
+}
+
+void GenericQMLBridge::attachScene(QObject *root)
+{
+    m_rootObject = root;
+    m_window = qobject_cast<QQuickWindow *>(m_rootObject);
+    m_changePublisher->attachToWindow(m_window);
+    if (m_window) {
+        // afterAnimating is emitted on the GUI thread once per frame,
+        // before the scene graph is synchronized
+        connect(m_window, &QQuickWindow::afterAnimating, this, &GenericQMLBridge::drainInbound,
+                Qt::UniqueConnection);
+    }
+}
+
+void GenericQMLBridge::setHotReload(bool enabled)
+{
+    m_hotReload = enabled;
+    if (!enabled) {
+        delete m_qmlWatcher;
+        m_qmlWatcher = nullptr;
+        m_lastWritten.clear();
+        return;
+    }
+    if (!m_qmlWatcher) {
+        m_qmlWatcher = new QFileSystemWatcher(this);
+        m_reloadTimer = new QTimer(m_qmlWatcher);
+        // Editors often write a file in several steps
+        m_reloadTimer->setSingleShot(true);
+        m_reloadTimer->setInterval(ReloadDelayMs);
+        connect(m_reloadTimer, &QTimer::timeout, this, &GenericQMLBridge::reloadQML);
+        connect(m_qmlWatcher, &QFileSystemWatcher::fileChanged, m_reloadTimer, qOverload<>(&QTimer::start));
+        connect(m_qmlWatcher, &QFileSystemWatcher::directoryChanged, m_reloadTimer, qOverload<>(&QTimer::start));
+    }
+    if (!m_qmlFile.isEmpty())
+        watchQmlSources();
+}
+
+void GenericQMLBridge::watchQmlSources()
+{
+    // The loaded file and the components next to it. The directory itself
+    // catches editors that save by replacing the file, which drops it
+    // from the watch.
+    const QFileInfo main(m_qmlFile);
+    QStringList paths = { main.absolutePath() };
+    const QFileInfoList sources = main.absoluteDir().entryInfoList(
+            { QStringLiteral("*.qml"), QStringLiteral("*.js"), QStringLiteral("*.mjs"), QStringLiteral("qmldir") },
+            QDir::Files);
+    for (const QFileInfo &source : sources)
+        paths.append(source.absoluteFilePath());
+
+    const QStringList watched = m_qmlWatcher->files() + m_qmlWatcher->directories();
+    if (!watched.isEmpty())
+        m_qmlWatcher->removePaths(watched);
+    m_qmlWatcher->addPaths(paths);
+}
+
+void GenericQMLBridge::reloadQML()
+{
+    if (m_qmlFile.isEmpty())
+        return;
+    QElapsedTimer timer;
+    timer.start();
+
+    // The schema before, so clients only get what changed
+    QHash<quint16, QCborMap> oldProperties;
+    QHash<quint16, QCborMap> oldMethods;
+    for (qsizetype id = 0; id < m_propertyTable.size(); ++id) {
+        if (!m_propertyTable.at(id).name.isEmpty())
+            oldProperties.insert(quint16(id), propertyListEntry(quint16(id)));
+    }
+    for (qsizetype id = 0; id < m_methodTable.size(); ++id) {
+        if (!m_methodTable.at(id).name.isEmpty())
+            oldMethods.insert(quint16(id), methodListEntry(quint16(id)));
+    }
+
+    // Detach from the old scene. Sessions keep their watch sets, and the
+    // name -> ID maps are kept, so every name keeps its ID.
+    flushStagedProperties();
+    clearDiscovery();
+    QObject *oldRoot = m_rootObject;
+    m_rootObject = nullptr;
+    m_window = nullptr;
+    m_changePublisher->attachToWindow(nullptr);
+    delete oldRoot;
+    m_engine->clearComponentCache();
+
+    QObject *root = createScene(m_qmlFile);
+    watchQmlSources();
+    if (root) {
+        attachScene(root);
+        if (!m_discoveryCachePath.isEmpty())
+            m_sourceHash = DiscoveryCache::sourceHash(m_qmlFile, m_discoverySourceRoot);
+        discoverProperties();
+    } else {
+        // Likely saved half-way; the next save reloads again
+        qWarning() << "Hot reload of" << m_qmlFile << "failed, waiting for the next change";
+    }
+
+    // Values written by clients win over the new QML's initial values
+    for (qsizetype id = 0; id < m_lastWritten.size(); ++id) {
+        QVariant value = m_lastWritten.at(id);
+        const PropertyEntry *entry = value.isValid() ? resolvedProperty(int(id)) : nullptr;
+        if (entry)
+            writeProperty(*entry, value);
+    }
+
+    // A changed entry is sent as removed and added again
+    for (qsizetype id = 0; id < m_propertyTable.size(); ++id) {
+        if (m_propertyTable.at(id).name.isEmpty())
+            continue;
+        const auto old = oldProperties.constFind(quint16(id));
+        if (old != oldProperties.constEnd() && old.value() == propertyListEntry(quint16(id))) {
+            oldProperties.erase(old);
+            continue;
+        }
+        m_addedPropertyIds.append(quint16(id));
+    }
+    for (qsizetype id = 0; id < m_methodTable.size(); ++id) {
+        if (m_methodTable.at(id).name.isEmpty())
+            continue;
+        const auto old = oldMethods.constFind(quint16(id));
+        if (old != oldMethods.constEnd() && old.value() == methodListEntry(quint16(id))) {
+            oldMethods.erase(old);
+            continue;
+        }
+        m_addedMethodIds.append(quint16(id));
+    }
+    for (auto it = oldProperties.cbegin(); it != oldProperties.cend(); ++it)
+        m_removedNames.append(m_propertyIdMap.value(it.key()));
+    for (auto it = oldMethods.cbegin(); it != oldMethods.cend(); ++it)
+        m_removedNames.append(m_methodIdMap.value(it.key()));
+    sendSchemaDelta();
+
+    qDebug() << "Reloaded" << m_qmlFile << "in" << timer.elapsed() << "ms";
+}
+
+void GenericQMLBridge::setDiscoveryCache(const QString &path, const QString &sourceRoot)
+{
+    m_discoveryCachePath = path;
+    m_discoverySourceRoot = sourceRoot;
+}
+
+void GenericQMLBridge::clearDiscovery()
+{
+    // m_propertyIdMap/m_propertyNameMap and their method counterparts
+    // survive rescans so a name keeps its ID; only the resolved table
+    // entries are dropped
+    invalidatePropertyList();
+    for (PropertyEntry &entry : m_propertyTable)
+        entry = PropertyEntry();
+    for (MethodEntry &entry : m_methodTable)
+        entry = MethodEntry();
+    m_objectPaths.clear();
+    m_rescanQueued = false;
+    // Watches and cached values point at the old objects. Sessions keep
+    // their watch sets; reattachWatches() connects them again.
+    for (qsizetype id = 0; id < m_propertyTable.size(); ++id) {
+        if (m_valueCache.contains(quint16(id)) || m_subscribers.contains(quint16(id)))
+            m_propertyObserver->unwatch(quint16(id));
+    }
+    m_valueCache.clear();
+
+    for (auto it = m_discovered.cbegin(); it != m_discovered.cend(); ++it) {
+        it.key()->removeEventFilter(this);
+        for (const QMetaObject::Connection &connection : it->connections)
+            disconnect(connection);
+    }
+    m_discovered.clear();
+    m_dirtyObjects.clear();
+    m_addedPropertyIds.clear();
+    m_addedMethodIds.clear();
+    m_removedNames.clear();
+}
+
 void GenericQMLBridge::discoverProperties()
 {
     if (!m_rootObject) return;
 
+    clearDiscovery();
+
     scanObjectProperties(m_rootObject);
-    qDebug() << "Discovered" << m_properties.size() << "properties";
+    reattachWatches();
+    qDebug() << "Discovered"
+             << std::count_if(m_propertyTable.cbegin(), m_propertyTable.cend(),
+                              [](const PropertyEntry &entry) { return !entry.name.isEmpty(); })
+             << "properties and"
+             << std::count_if(m_methodTable.cbegin(), m_methodTable.cend(),
+                              [](const MethodEntry &entry) { return !entry.name.isEmpty(); })
+             << "methods";
+
+    if (!m_discoveryCachePath.isEmpty())
+        saveDiscoveryCache();
+}
+
+bool GenericQMLBridge::restoreDiscoveryCache()
+{
+    if (m_discoveryCachePath.isEmpty() || !m_rootObject)
+        return false;
+    DiscoveryCache cache;
+    if (!cache.load(m_discoveryCachePath, m_sourceHash))
+        return false;
+
+    // IDs handed out earlier in this run win over the cached ones
+    for (const DiscoveryCache::Property &prop : std::as_const(cache.properties)) {
+        const auto byName = m_propertyNameMap.constFind(prop.name);
+        const auto byId = m_propertyIdMap.constFind(prop.id);
+        if ((byName != m_propertyNameMap.constEnd() && byName.value() != prop.id)
+                || (byId != m_propertyIdMap.constEnd() && byId.value() != prop.name))
+            return false;
+    }
+    for (const DiscoveryCache::Method &method : std::as_const(cache.methods)) {
+        const auto byName = m_methodNameMap.constFind(method.name);
+        const auto byId = m_methodIdMap.constFind(method.id);
+        if ((byName != m_methodNameMap.constEnd() && byName.value() != method.id)
+                || (byId != m_methodIdMap.constEnd() && byId.value() != method.name))
+            return false;
+    }
+
+    // Entries stay pending until first used, see resolvedProperty()
+    clearDiscovery();
+    for (const DiscoveryCache::Property &prop : std::as_const(cache.properties)) {
+        m_propertyIdMap.insert(prop.id, prop.name);
+        m_propertyNameMap.insert(prop.name, prop.id);
+        m_nextPropertyId = qMax(m_nextPropertyId, int(prop.id) + 1);
+        if (prop.id >= m_propertyTable.size())
+            m_propertyTable.resize(prop.id + 1);
+        PropertyEntry &entry = m_propertyTable[prop.id];
+        entry.name = prop.name;
+        entry.path = prop.path;
+        entry.propertyIndex = prop.propertyIndex;
+        entry.typeName = prop.typeName;
+        entry.metaType = QMetaType::fromName(prop.typeName);
+        entry.wireType = wireTypeFor(entry.metaType);
+        entry.pending = true;
+    }
+    for (const DiscoveryCache::Method &method : std::as_const(cache.methods)) {
+        m_methodIdMap.insert(method.id, method.name);
+        m_methodNameMap.insert(method.name, method.id);
+        m_nextMethodId = qMax(m_nextMethodId, int(method.id) + 1);
+        if (method.id >= m_methodTable.size())
+            m_methodTable.resize(method.id + 1);
+        MethodEntry &entry = m_methodTable[method.id];
+        entry.name = method.name;
+        entry.path = method.path;
+        entry.methodIndex = method.methodIndex;
+        entry.signature = method.signature;
+        entry.parameterTypeNames = method.parameterTypeNames;
+        entry.pending = true;
+    }
+    // Walk the objects once to follow later changes; their properties are
+    // not looked at
+    QHash<QString, DiscoveredObject> restored;
+    for (const DiscoveryCache::Property &prop : std::as_const(cache.properties))
+        restored[prop.path].propertyIds.append(prop.id);
+    for (const DiscoveryCache::Method &method : std::as_const(cache.methods))
+        restored[method.path].methodIds.append(method.id);
+    trackRestoredObject(m_rootObject, QString(), nullptr, restored);
+    reattachWatches();
+
+    qDebug() << "Restored" << cache.properties.size() << "properties and" << cache.methods.size()
+             << "methods from" << m_discoveryCachePath;
+    return true;
+}
+
+void GenericQMLBridge::reattachWatches()
+{
+    // After a rescan, watched IDs follow their names to the new objects,
+    // and watchers get the current value once
+    for (auto it = m_subscribers.cbegin(); it != m_subscribers.cend(); ++it) {
+        const PropertyEntry *entry = resolvedProperty(it.key());
+        if (entry && m_propertyObserver->watch(it.key(), entry->object, entry->property))
+            m_changePublisher->markDirty(it.key(), entry->property.read(entry->object));
+    }
+}
+
+void GenericQMLBridge::saveDiscoveryCache()
+{
+    DiscoveryCache cache;
+    for (qsizetype id = 0; id < m_propertyTable.size(); ++id) {
+        const PropertyEntry &entry = m_propertyTable.at(id);
+        if (entry.name.isEmpty())
+            continue;
+        cache.properties.append({ quint16(id), entry.name, entry.path, entry.propertyIndex, entry.typeName });
+    }
+    for (qsizetype id = 0; id < m_methodTable.size(); ++id) {
+        const MethodEntry &entry = m_methodTable.at(id);
+        if (entry.name.isEmpty())
+            continue;
+        cache.methods.append({ quint16(id), entry.name, entry.path, entry.methodIndex,
+                               entry.signature, entry.parameterTypeNames });
+    }
+    if (cache.save(m_discoveryCachePath, m_sourceHash))
+        qCDebug(lcBridge) << "Discovery cache written to" << m_discoveryCachePath;
+}
+
+QObject *GenericQMLBridge::objectAtPath(const QString &path)
+{
+    if (path.isEmpty())
+        return m_rootObject;
+    const auto cached = m_objectPaths.constFind(path);
+    if (cached != m_objectPaths.constEnd())
+        return cached.value();
+
+    const qsizetype dot = path.lastIndexOf(QLatin1Char('.'));
+    QObject *parent = objectAtPath(dot < 0 ? QString() : path.left(dot));
+    QObject *obj = nullptr;
+    if (parent) {
+        // Same pick as scanObjectProperties(), where a later child with the
+        // same name overwrites the entries of an earlier one
+        const QString name = path.mid(dot + 1);
+        for (QObject *child : discoveryChildren(parent)) {
+            if (child->objectName() == name)
+                obj = child;
+        }
+    }
+    m_objectPaths.insert(path, obj);
+    return obj;
+}
+
+GenericQMLBridge::PropertyEntry *GenericQMLBridge::resolvedProperty(int id)
+{
+    if (id < 0 || id >= m_propertyTable.size())
+        return nullptr;
+    PropertyEntry &entry = m_propertyTable[id];
+    if (entry.pending) {
+        entry.pending = false;
+        QObject *obj = objectAtPath(entry.path);
+        const QMetaObject *metaObj = obj ? obj->metaObject() : nullptr;
+        const QMetaProperty prop = metaObj && entry.propertyIndex < metaObj->propertyCount()
+                                 ? metaObj->property(entry.propertyIndex) : QMetaProperty();
+        const QString shortName = entry.path.isEmpty() ? entry.name : entry.name.mid(entry.path.size() + 1);
+        if (!prop.isWritable() || shortName != QLatin1String(prop.name())) {
+            qWarning() << "Discovery cache does not match the scene at" << entry.name << "- rescanning";
+            entry = PropertyEntry();
+            scheduleRescan();
+            return nullptr;
+        }
+        entry.object = obj;
+        entry.property = prop;
+        entry.qmlProperty = QQmlProperty(obj, prop.name());
+        entry.metaType = prop.metaType();
+        entry.wireType = wireTypeFor(entry.metaType);
+    }
+    return entry.object ? &entry : nullptr;
+}
+
+GenericQMLBridge::MethodEntry *GenericQMLBridge::resolvedMethod(int id)
+{
+    if (id < 0 || id >= m_methodTable.size())
+        return nullptr;
+    MethodEntry &entry = m_methodTable[id];
+    if (entry.pending) {
+        entry.pending = false;
+        QObject *obj = objectAtPath(entry.path);
+        const QMetaObject *metaObj = obj ? obj->metaObject() : nullptr;
+        const QMetaMethod method = metaObj && entry.methodIndex < metaObj->methodCount()
+                                 ? metaObj->method(entry.methodIndex) : QMetaMethod();
+        QList<QMetaType> parameterTypes;
+        for (int i = 0; method.isValid() && i < method.parameterCount(); ++i)
+            parameterTypes.append(method.parameterMetaType(i));
+        if (method.methodSignature() != entry.signature
+                || std::any_of(parameterTypes.cbegin(), parameterTypes.cend(),
+                               [](QMetaType type) { return !type.isValid(); })) {
+            qWarning() << "Discovery cache does not match the scene at" << entry.name << "- rescanning";
+            entry = MethodEntry();
+            scheduleRescan();
+            return nullptr;
+        }
+        entry.object = obj;
+        entry.method = method;
+        entry.parameterTypes = std::move(parameterTypes);
+    }
+    return entry.object ? &entry : nullptr;
 }
 
-void GenericQMLBridge::scanObjectProperties(QObject *obj, const QString &prefix)
+void GenericQMLBridge::scheduleRescan()
 {
-    if (!obj) return;
+    if (m_rescanQueued)
+        return;
+    m_rescanQueued = true;
+    QMetaObject::invokeMethod(this, &GenericQMLBridge::discoverProperties, Qt::QueuedConnection);
+}
 
+void GenericQMLBridge::scanObjectProperties(QObject *obj, const QString &prefix, QObject *parent)
+{
+    if (!obj || m_discovered.contains(obj)) return;
+
+    DiscoveredObject node;
+    node.parent = parent;
+    node.path = prefix;
     const QMetaObject *metaObj = obj->metaObject();
     for (int i = 0; i < metaObj->propertyCount(); ++i) {
         QMetaProperty prop = metaObj->property(i);
@@ -69,457 +581,1622 @@ void GenericQMLBridge::scanObjectProperties(QObject *obj, const QString &prefix)
         if (prop.isWritable() && prop.isReadable()) {
             QQmlProperty qmlProp(obj, prop.name());
             if (qmlProp.isValid()) {
-                m_properties[propName] = qmlProp;
-                quint8 id = static_cast<quint8>(m_properties.size() - 1);
-                m_propertyIdMap[id] = propName;
-                m_propertyNameMap[propName] = id;
+                int id = assignPropertyId(propName);
+                if (id < 0) {
+                    qDebug() << "Property ID space exhausted, skipping:" << propName;
+                    continue;
+                }
+                if (id >= m_propertyTable.size())
+                    m_propertyTable.resize(id + 1);
+                PropertyEntry &entry = m_propertyTable[id];
+                entry.name = propName;
+                entry.path = prefix;
+                entry.typeName = prop.typeName();
+                entry.object = obj;
+                entry.property = prop;
+                entry.qmlProperty = qmlProp;
+                entry.propertyIndex = prop.propertyIndex();
+                entry.metaType = prop.metaType();
+                entry.wireType = wireTypeFor(entry.metaType);
+                node.propertyIds.append(quint16(id));
 
-                qDebug() << "Detected property:" << propName
+                qCDebug(lcBridge) << "Detected property:" << propName
                          << "Type:" << prop.typeName()
                          << "ID:" << id;
             }
         }
     }
 
-    for (int i = 0; i < metaObj->methodCount(); ++i) {
+    // QObject's own slots (deleteLater, ...) are not exposed
+    for (int i = QObject::staticMetaObject.methodCount(); i < metaObj->methodCount(); ++i) {
         QMetaMethod method = metaObj->method(i);
-        if (method.methodType() == QMetaMethod::Slot) {
-            QString methodName = prefix.isEmpty() ? method.name() : prefix + "." + method.name();
-            m_methods[methodName] = method;
-            qDebug() << "Detected method:" << methodName;
+        if (method.methodType() == QMetaMethod::Slot || method.methodType() == QMetaMethod::Method) {
+            const int id = addMethod(obj, method, prefix);
+            if (id >= 0 && !node.methodIds.contains(quint16(id)))
+                node.methodIds.append(quint16(id));
         }
     }
-    QObjectList children = obj->findChildren<QObject*>(QString(), Qt::FindDirectChildrenOnly);
-    for (QObject *child : children) {
+    trackObject(obj, std::move(node));
+
+    for (QObject *child : discoveryChildren(obj)) {
         QString childName = child->objectName();
-        if (!childName.isEmpty()) {
-            QString childPrefix = prefix.isEmpty() ? childName : prefix + "." + childName;
-            scanObjectProperties(child, childPrefix);
+        if (!childName.isEmpty())
+            scanObjectProperties(child, childPath(prefix, childName), obj);
+    }
+}
+
+void GenericQMLBridge::trackRestoredObject(QObject *obj, const QString &path, QObject *parent,
+                                           const QHash<QString, DiscoveredObject> &restored)
+{
+    if (m_discovered.contains(obj))
+        return;
+    const auto known = restored.constFind(path);
+    if (known == restored.constEnd()) {
+        // Not in the cache: nothing there, or created since it was written
+        scanObjectProperties(obj, path, parent);
+        return;
+    }
+    DiscoveredObject node = known.value();
+    node.parent = parent;
+    node.path = path;
+    m_objectPaths.insert(path, obj);
+    trackObject(obj, std::move(node));
+
+    for (QObject *child : discoveryChildren(obj)) {
+        const QString childName = child->objectName();
+        if (!childName.isEmpty())
+            trackRestoredObject(child, childPath(path, childName), obj, restored);
+    }
+}
+
+void GenericQMLBridge::trackObject(QObject *obj, DiscoveredObject node)
+{
+    // Children are picked up through ChildAdded/ChildRemoved, and through
+    // childrenChanged for items whose visual children have another parent
+    obj->installEventFilter(this);
+    node.connections.append(connect(obj, &QObject::destroyed, this, [this](QObject *gone) {
+        forgetObject(gone, true);
+    }));
+    if (node.parent) {
+        QObject *parent = node.parent;
+        node.connections.append(connect(obj, &QObject::objectNameChanged, this, [this, parent]() {
+            markDiscoveryDirty(parent);
+        }));
+    }
+    if (auto *item = qobject_cast<QQuickItem *>(obj)) {
+        node.connections.append(connect(item, &QQuickItem::childrenChanged, this, [this, obj]() {
+            markDiscoveryDirty(obj);
+        }));
+    }
+    if (node.parent) {
+        auto parent = m_discovered.find(node.parent);
+        if (parent != m_discovered.end())
+            parent->children.append(obj);
+    }
+    m_discovered.insert(obj, std::move(node));
+}
+
+bool GenericQMLBridge::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::ChildAdded || event->type() == QEvent::ChildRemoved)
+        markDiscoveryDirty(watched);
+    return QObject::eventFilter(watched, event);
+}
+
+void GenericQMLBridge::markDiscoveryDirty(QObject *obj)
+{
+    m_dirtyObjects.insert(obj);
+    m_discoveryTimer->start();
+}
+
+void GenericQMLBridge::processDiscoveryChanges()
+{
+    const QSet<QObject *> dirty = std::exchange(m_dirtyObjects, {});
+    for (QObject *obj : dirty) {
+        // Dropped meanwhile, as a child of another dirty object or because
+        // it was destroyed
+        const auto it = m_discovered.constFind(obj);
+        if (it == m_discovered.constEnd())
+            continue;
+        const QString path = it->path;
+        const QList<QObject *> known = it->children;
+
+        QSet<QObject *> current;
+        for (QObject *child : discoveryChildren(obj)) {
+            if (!child->objectName().isEmpty())
+                current.insert(child);
+        }
+        // Children that left, or whose name (and so path) changed
+        for (QObject *child : known) {
+            const auto node = m_discovered.constFind(child);
+            if (node == m_discovered.constEnd())
+                continue;
+            if (!current.contains(child) || node->path != childPath(path, child->objectName()))
+                forgetObject(child, false);
+        }
+        for (QObject *child : std::as_const(current)) {
+            if (m_discovered.contains(child))
+                continue;
+            scanObjectProperties(child, childPath(path, child->objectName()), obj);
+            collectAddedEntries(child);
+        }
+    }
+    sendSchemaDelta();
+}
+
+void GenericQMLBridge::collectAddedEntries(QObject *obj)
+{
+    const auto it = m_discovered.constFind(obj);
+    if (it == m_discovered.constEnd())
+        return;
+    for (quint16 id : it->propertyIds) {
+        m_addedPropertyIds.append(id);
+        // Clients that kept watching the ID get the new object's changes,
+        // starting with its current value
+        if (!m_subscribers.contains(id))
+            continue;
+        const PropertyEntry &entry = m_propertyTable.at(id);
+        if (m_propertyObserver->watch(id, entry.object, entry.property))
+            m_changePublisher->markDirty(id, entry.property.read(entry.object));
+    }
+    m_addedMethodIds.append(it->methodIds);
+    for (QObject *child : it->children)
+        collectAddedEntries(child);
+}
+
+void GenericQMLBridge::forgetObject(QObject *obj, bool destroyed)
+{
+    auto it = m_discovered.find(obj);
+    if (it == m_discovered.end())
+        return;
+    const DiscoveredObject node = std::move(it.value());
+    m_discovered.erase(it);
+    m_dirtyObjects.remove(obj);
+    m_objectPaths.remove(node.path);
+    if (!destroyed) {
+        obj->removeEventFilter(this);
+        for (const QMetaObject::Connection &connection : node.connections)
+            disconnect(connection);
+    }
+    if (node.parent) {
+        auto parent = m_discovered.find(node.parent);
+        if (parent != m_discovered.end())
+            parent->children.removeOne(obj);
+    }
+
+    // IDs stay assigned to their names, so a subtree that comes back gets
+    // the same IDs. Watches stay with the sessions and resume then.
+    for (quint16 id : node.propertyIds) {
+        PropertyEntry &entry = m_propertyTable[id];
+        if (entry.name.isEmpty() || (!entry.pending && entry.object != obj))
+            continue;
+        m_removedNames.append(entry.name);
+        entry = PropertyEntry();
+        m_propertyObserver->unwatch(id);
+        m_valueCache.remove(id);
+    }
+    for (quint16 id : node.methodIds) {
+        MethodEntry &entry = m_methodTable[id];
+        if (entry.name.isEmpty() || (!entry.pending && entry.object != obj))
+            continue;
+        m_removedNames.append(entry.name);
+        entry = MethodEntry();
+    }
+    for (QObject *child : node.children)
+        forgetObject(child, false);
+
+    invalidatePropertyList();
+    m_discoveryTimer->start();
+}
+
+void GenericQMLBridge::sendSchemaDelta()
+{
+    if (m_addedPropertyIds.isEmpty() && m_addedMethodIds.isEmpty() && m_removedNames.isEmpty())
+        return;
+
+    QCborMap added;
+    for (quint16 id : std::as_const(m_addedPropertyIds)) {
+        if (!m_propertyTable.at(id).name.isEmpty())
+            added[m_propertyTable.at(id).name] = propertyListEntry(id);
+    }
+    for (quint16 id : std::as_const(m_addedMethodIds)) {
+        if (!m_methodTable.at(id).name.isEmpty())
+            added[m_methodTable.at(id).name] = methodListEntry(id);
+    }
+    QCborArray removed;
+    for (const QString &name : std::as_const(m_removedNames))
+        removed.append(name);
+    qCDebug(lcBridge) << "Schema delta:" << added.size() << "added," << removed.size() << "removed";
+    m_addedPropertyIds.clear();
+    m_addedMethodIds.clear();
+    m_removedNames.clear();
+    invalidatePropertyList();
+
+    QCborMap delta;
+    delta[QStringLiteral("removed")] = removed;
+    delta[QStringLiteral("added")] = added;
+    QByteArray packet;
+    packet.append(static_cast<char>(RESP_SCHEMA_DELTA));
+    {
+        QCborStreamWriter writer(&packet);
+        QCborValue(delta).toCbor(writer);
+    }
+    for (auto it = m_sessions.cbegin(); it != m_sessions.cend(); ++it) {
+        if (it->schemaKnown)
+            sendSlipDataTo(it.key(), packet);
+    }
+}
+
+int GenericQMLBridge::assignPropertyId(const QString &propName)
+{
+    // IDs are handed out once per name and never reused, so they stay
+    // stable across rescans and reloads
+    auto it = m_propertyNameMap.constFind(propName);
+    if (it != m_propertyNameMap.constEnd())
+        return it.value();
+
+    const int id = m_nextPropertyId;
+    if (id > MaxPropertyId)
+        return -1;
+    ++m_nextPropertyId;
+    m_propertyIdMap.insert(quint16(id), propName);
+    m_propertyNameMap.insert(propName, quint16(id));
+    return id;
+}
+
+int GenericQMLBridge::assignMethodId(const QString &methodName)
+{
+    // Same rules as property IDs, in a separate space
+    auto it = m_methodNameMap.constFind(methodName);
+    if (it != m_methodNameMap.constEnd())
+        return it.value();
+
+    const int id = m_nextMethodId;
+    if (id > MaxPropertyId)
+        return -1;
+    ++m_nextMethodId;
+    m_methodIdMap.insert(quint16(id), methodName);
+    m_methodNameMap.insert(methodName, quint16(id));
+    return id;
+}
+
+int GenericQMLBridge::addMethod(QObject *obj, const QMetaMethod &method, const QString &prefix)
+{
+    const QString methodName = prefix.isEmpty() ? QString::fromLatin1(method.name())
+                                                : prefix + QLatin1Char('.') + QString::fromLatin1(method.name());
+    QList<QMetaType> parameterTypes;
+    QList<QByteArray> parameterTypeNames;
+    parameterTypes.reserve(method.parameterCount());
+    for (int i = 0; i < method.parameterCount(); ++i) {
+        const QMetaType type = method.parameterMetaType(i);
+        if (!type.isValid()) {
+            qCDebug(lcBridge) << "Skipping method with unregistered parameter type:" << methodName
+                              << method.parameterTypeName(i);
+            return -1;
         }
+        parameterTypes.append(type);
+        parameterTypeNames.append(method.parameterTypeName(i));
+    }
+
+    const int id = assignMethodId(methodName);
+    if (id < 0) {
+        qDebug() << "Method ID space exhausted, skipping:" << methodName;
+        return -1;
     }
+    if (id >= m_methodTable.size())
+        m_methodTable.resize(id + 1);
+    MethodEntry &entry = m_methodTable[id];
+    // Of several overloads, keep the one taking the most arguments; the
+    // others are reached by leaving trailing arguments out
+    if (entry.object == obj && entry.parameterTypes.size() >= parameterTypes.size())
+        return id;
+    entry.name = methodName;
+    entry.path = prefix;
+    entry.object = obj;
+    entry.method = method;
+    entry.methodIndex = method.methodIndex();
+    entry.signature = method.methodSignature();
+    entry.parameterTypes = std::move(parameterTypes);
+    entry.parameterTypeNames = std::move(parameterTypeNames);
+
+    qCDebug(lcBridge) << "Detected method:" << methodName
+                      << "Signature:" << method.methodSignature()
+                      << "ID:" << id;
+    return id;
 }
 
-void GenericQMLBridge::processCommand(const QByteArray &data)
+bool GenericQMLBridge::invokeMethod(int id, QCborStreamReader *args)
+{
+    const MethodEntry *method = resolvedMethod(id);
+    if (!method) {
+        qCDebug(lcBridge) << "Unknown method in INVOKE_METHOD:" << id;
+        m_metrics.countUnknownId();
+        return false;
+    }
+    const MethodEntry &entry = *method;
+    const qsizetype count = entry.parameterTypes.size();
+
+    // Arguments are read straight into the parameter types; missing
+    // trailing arguments are default-constructed
+    QVarLengthArray<QVariant, 8> values(count);
+    if (args && args->isArray() && args->enterContainer()) {
+        qsizetype index = 0;
+        bool converted = true;
+        while (args->lastError() == QCborError::NoError && args->hasNext()) {
+            if (index < count) {
+                bool ok = true;
+                values[index] = CborValueReader::readValue(*args, entry.parameterTypes.at(index), &ok);
+                if (!ok && converted) {
+                    qCDebug(lcBridge) << "Rejecting call to" << entry.name << "- argument" << index
+                                      << "does not convert to" << entry.parameterTypes.at(index).name();
+                    converted = false;
+                }
+            } else {
+                args->next();
+            }
+            ++index;
+        }
+        if (index > count)
+            qCDebug(lcBridge) << "Ignoring" << index - count << "extra arguments to" << entry.name;
+        args->leaveContainer();
+        if (!converted)
+            return false;
+    }
+    if (args && args->lastError() != QCborError::NoError) {
+        qCDebug(lcBridge) << "Error: malformed INVOKE_METHOD arguments:" << args->lastError().toString();
+        return false;
+    }
+
+    // argv[0] is the return value, which is discarded. The callee takes
+    // each argument's storage as the parameter type, so anything that is
+    // not exactly that type must not reach it.
+    QVarLengthArray<void *, 9> argv(count + 1);
+    argv[0] = nullptr;
+    for (qsizetype i = 0; i < count; ++i) {
+        const QMetaType type = entry.parameterTypes.at(i);
+        QVariant &value = values[i];
+        if (type.id() == QMetaType::QVariant) {
+            argv[i + 1] = &value;
+            continue;
+        }
+        if (!value.isValid())
+            value = QVariant(type);
+        else if (value.metaType() != type && !value.convert(type))
+            value = QVariant();
+        if (!value.isValid() || value.metaType() != type) {
+            qCDebug(lcBridge) << "Rejecting call to" << entry.name << "- argument" << i
+                              << "does not convert to" << type.name();
+            return false;
+        }
+        argv[i + 1] = value.data();
+    }
+    QMetaObject::metacall(entry.object, QMetaObject::InvokeMetaMethod, entry.methodIndex, argv.data());
+    qCDebug(lcBridge) << "Method invoked:" << entry.name << "with" << count << "arguments";
+    return true;
+}
+
+void GenericQMLBridge::invokeBatch(const char *payload, int size)
+{
+    if (size <= 0) {
+        qCDebug(lcBridge) << "Error: INVOKE_BATCH missing CBOR array payload";
+        return;
+    }
+    QCborStreamReader reader(payload, size);
+    if (!reader.isArray() || !reader.enterContainer()) {
+        qCDebug(lcBridge) << "Error: INVOKE_BATCH payload is not a CBOR array";
+        return;
+    }
+    // Each call is [method, [args...]], run in order; the method is an ID,
+    // or a name as the slower fallback
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isArray() || !reader.enterContainer()) {
+            reader.next();
+            continue;
+        }
+        int id = -1;
+        if (reader.isInteger()) {
+            const qint64 value = reader.toInteger();
+            if (value >= 0 && value <= MaxPropertyId)
+                id = int(value);
+            reader.next();
+        } else if (reader.isString()) {
+            const QString name = CborValueReader::readString(reader);
+            auto byName = m_methodNameMap.constFind(name);
+            if (byName != m_methodNameMap.constEnd())
+                id = byName.value();
+            else
+                qCDebug(lcBridge) << "Unknown method name in INVOKE_BATCH:" << name;
+        } else {
+            reader.next();
+        }
+        invokeMethod(id, reader.hasNext() ? &reader : nullptr);
+        while (reader.lastError() == QCborError::NoError && reader.hasNext())
+            reader.next();
+        reader.leaveContainer();
+    }
+    if (reader.lastError() != QCborError::NoError)
+        qCDebug(lcBridge) << "Error: malformed INVOKE_BATCH payload:" << reader.lastError().toString();
+}
+
+void GenericQMLBridge::sendValues(quint32 target, const char *payload, int size)
+{
+    // [ids or null] [since]: both optional, no list means every property
+    QList<quint16> ids;
+    bool all = true;
+    quint64 since = 0;
+    if (size > 0) {
+        QCborStreamReader reader(payload, size);
+        if (reader.isArray() && reader.enterContainer()) {
+            all = false;
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                if (reader.isUnsignedInteger()) {
+                    const quint64 id = reader.toUnsignedInteger();
+                    if (id <= MaxPropertyId)
+                        ids.append(quint16(id));
+                    reader.next();
+                } else if (reader.isString()) {
+                    const QString name = CborValueReader::readString(reader);
+                    const auto byName = m_propertyNameMap.constFind(name);
+                    if (byName != m_propertyNameMap.constEnd())
+                        ids.append(byName.value());
+                    else
+                        qCDebug(lcBridge) << "Unknown property name in READ_VALUES:" << name;
+                } else {
+                    reader.next();
+                }
+            }
+            reader.leaveContainer();
+        } else if (reader.isNull()) {
+            reader.next();
+        }
+        if (reader.lastError() == QCborError::NoError && reader.isUnsignedInteger())
+            since = reader.toUnsignedInteger();
+        if (reader.lastError() != QCborError::NoError) {
+            qCDebug(lcBridge) << "Error: malformed READ_VALUES payload:" << reader.lastError().toString();
+            return;
+        }
+    }
+    if (all) {
+        for (qsizetype id = 0; id < m_propertyTable.size(); ++id) {
+            if (!m_propertyTable.at(id).name.isEmpty())
+                ids.append(quint16(id));
+        }
+    }
+
+    // Values first: reading them may move the version on
+    m_entryBuffer.resize(0);
+    {
+        QCborStreamWriter writer(&m_entryBuffer);
+        writer.startMap();
+        for (quint16 id : std::as_const(ids)) {
+            const PropertyEntry *entry = resolvedProperty(id);
+            if (!entry) {
+                m_metrics.countUnknownId();
+                continue;
+            }
+            const LastValueCache::Entry &cached = cachedValue(id, *entry);
+            if (cached.version <= since)
+                continue;
+            writer.append(quint64(id));
+            QCborValue::fromVariant(cached.value).toCbor(writer);
+        }
+        writer.endMap();
+    }
+
+    m_packetBuffer.resize(0);
+    m_packetBuffer.append(static_cast<char>(RESP_VALUES));
+    {
+        QCborStreamWriter writer(&m_packetBuffer);
+        writer.append(m_valueCache.version());
+    }
+    m_packetBuffer.append(m_entryBuffer);
+    sendSlipDataTo(target, m_packetBuffer);
+}
+
+const LastValueCache::Entry &GenericQMLBridge::cachedValue(quint16 id, const PropertyEntry &entry)
+{
+    // Observed and constant properties are read once; properties without
+    // a NOTIFY signal have to be read every time
+    const bool observed = m_propertyObserver->isWatching(id);
+    if (const LastValueCache::Entry *cached = m_valueCache.find(id)) {
+        if (observed || entry.property.isConstant())
+            return *cached;
+    }
+    if (!observed && entry.property.hasNotifySignal())
+        m_propertyObserver->watch(id, entry.object, entry.property);
+    return m_valueCache.store(id, entry.property.read(entry.object));
+}
+
+int GenericQMLBridge::propertyId(const QString &name) const
+{
+    auto it = m_propertyNameMap.constFind(name);
+    return it != m_propertyNameMap.constEnd() ? int(it.value()) : -1;
+}
+
+void GenericQMLBridge::processCommand(QByteArrayView data, quint32 source)
 {
     if (data.isEmpty()) return;
-    quint8 cmdType = static_cast<quint8>(data[0]);
+    QElapsedTimer timer;
+    timer.start();
+    dispatchCommand(data, source);
+    m_metrics.recordCommand(static_cast<quint8>(data.front()), timer.nsecsElapsed());
+}
+
+void GenericQMLBridge::dispatchCommand(QByteArrayView data, quint32 source)
+{
+    quint8 cmdType = static_cast<quint8>(data.data()[0]);
     const char* payload = data.constData() + 1;
     int payloadLen = data.size() - 1;
 
+    // Everything but another write may observe or depend on the writes
+    // staged so far, so apply them first
+    if (!m_stagedIds.isEmpty() && cmdType != CMD_SET_PROPERTY
+            && cmdType != CMD_SET_PROPERTY_PACKED && cmdType != CMD_HEARTBEAT)
+        flushStagedProperties();
+
     switch (cmdType) {
-    case CMD_GET_PROPERTY_LIST:
-        sendPropertyList();
+    case CMD_GET_PROPERTY_LIST: {
+        // An optional CBOR uint carries the schema hash the client cached
+        bool haveHash = false;
+        quint64 clientHash = 0;
+        if (payloadLen > 0) {
+            QCborStreamReader reader(payload, payloadLen);
+            if (reader.isUnsignedInteger()) {
+                clientHash = reader.toUnsignedInteger();
+                haveHash = true;
+            }
+        }
+        sendPropertyList(source, haveHash ? &clientHash : nullptr);
         return;
+    }
     case CMD_SET_PROPERTY: {
         if (payloadLen <= 0) {
-            qDebug() << "Error: SET_PROPERTY missing CBOR map payload";
+            qCDebug(lcBridge) << "Error: SET_PROPERTY missing CBOR map payload";
             return;
         }
-        QCborValue cbor = QCborValue::fromCbor(QByteArray(payload, payloadLen));
-        if (!cbor.isMap()) {
-            qDebug() << "Error: SET_PROPERTY payload is not a CBOR map";
+        // Pull-parse the map in place; each value is read straight into the
+        // metatype of the property it targets
+        QCborStreamReader reader(payload, payloadLen);
+        if (!reader.isMap() || !reader.enterContainer()) {
+            qCDebug(lcBridge) << "Error: SET_PROPERTY payload is not a CBOR map";
             return;
         }
-        QCborMap map = cbor.toMap();
-        for (auto it = map.begin(); it != map.end(); ++it) {
-            QString propName = it.key().toString();
-            if (!m_properties.contains(propName)) {
-                qDebug() << "Unknown property in SET_PROPERTY:" << propName;
+        while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+            qint64 id = -1;
+            QString propName;
+            if (!CborValueReader::readKey(reader, &id, &propName)) {
+                reader.next();
+                continue;
+            }
+            // Integer keys index the property table directly; names are
+            // the slower fallback
+            if (id < 0) {
+                auto byName = m_propertyNameMap.constFind(propName);
+                if (byName != m_propertyNameMap.constEnd())
+                    id = byName.value();
+            }
+            const PropertyEntry *entry = id <= MaxPropertyId ? resolvedProperty(int(id)) : nullptr;
+            if (!entry) {
+                qCDebug(lcBridge) << "Unknown property in SET_PROPERTY:" << (propName.isEmpty() ? QString::number(id) : propName);
+                m_metrics.countUnknownId();
+                reader.next();
+                continue;
+            }
+            bool ok = true;
+            QVariant value = CborValueReader::readValue(reader, entry->metaType, &ok);
+            if (!ok) {
+                // Writing the null result would reset the property
+                qCDebug(lcBridge) << "Ignoring SET_PROPERTY value for" << entry->name
+                                  << "- it does not convert to" << entry->metaType.name();
                 continue;
             }
-            QQmlProperty prop = m_properties[propName];
-            QVariant value = it.value().toVariant();
-            bool success = prop.write(value);
-            qDebug() << "Property updated:" << propName << "=" << value << "Success:" << success;
+            stageProperty(quint16(id), value);
         }
+        if (reader.lastError() != QCborError::NoError)
+            qCDebug(lcBridge) << "Error: malformed SET_PROPERTY payload:" << reader.lastError().toString();
         return;
     }
+    case CMD_SET_PROPERTY_PACKED:
+        setPackedProperties(payload, payloadLen, source);
+        return;
     case CMD_INVOKE_METHOD: {
-        if (payloadLen < 1) {
-            qDebug() << "Error: INVOKE_METHOD missing method id";
+        // Method IDs are one byte, or two big-endian bytes in wide mode
+        const int idSize = m_sessions.value(source).wideIds ? 2 : 1;
+        if (payloadLen < idSize) {
+            qCDebug(lcBridge) << "Error: INVOKE_METHOD missing method id";
             return;
         }
-        quint8 methodId = static_cast<quint8>(payload[0]);
-        QString methodName = m_propertyIdMap.value(methodId);
-        QCborArray params;
-        if (payloadLen > 1) {
-            QCborValue cborParams = QCborValue::fromCbor(QByteArray(payload + 1, payloadLen - 1));
-            if (cborParams.isArray())
-                params = cborParams.toArray();
-        }
-        if (m_methods.contains(methodName)) {
-            QMetaMethod method = m_methods[methodName];
-            QList<QVariant> args;
-            for (const QCborValue& v : params)
-                args << v.toVariant();
-            method.invoke(m_properties[methodName].object(), Qt::DirectConnection, QGenericArgument(args.value(0).typeName(), args.value(0).data()));
-            qDebug() << "Method invoked:" << methodName << "with args:" << args;
+        quint16 methodId = static_cast<quint8>(payload[0]);
+        if (idSize == 2)
+            methodId = quint16(methodId << 8) | static_cast<quint8>(payload[1]);
+        if (payloadLen > idSize) {
+            QCborStreamReader reader(payload + idSize, payloadLen - idSize);
+            invokeMethod(methodId, &reader);
+        } else {
+            invokeMethod(methodId, nullptr);
         }
         return;
     }
+    case CMD_INVOKE_BATCH:
+        invokeBatch(payload, payloadLen);
+        return;
     case CMD_WATCH_PROPERTY: {
-        for (auto conn : m_watchedConnections.values())
-            QObject::disconnect(conn);
-        m_watchedConnections.clear();
-        m_watchedPropertyIds.clear();
-        if (payloadLen <= 0) {
-            qDebug() << "Error: WATCH_PROPERTY missing CBOR array payload";
-            return;
-        }
-        QCborValue cbor = QCborValue::fromCbor(QByteArray(payload, payloadLen));
-        if (!cbor.isArray()) {
-            qDebug() << "Error: WATCH_PROPERTY payload is not a CBOR array";
-            return;
-        }
-        for (const QCborValue& v : cbor.toArray()) {
-            if (!v.isInteger())
-                continue;
-            quint8 id = static_cast<quint8>(v.toInteger());
-            
-            m_watchedPropertyIds.insert(id);
-            
-            QString propName = m_propertyIdMap.value(id);
-            
-            if (!m_properties.contains(propName))
-                continue;
-            
-            QQmlProperty qmlProp = m_properties[propName];
-
-            auto observer = QmlPropertyObserver::watch(qmlProp, [this, id](QVariant newValue) {
-                QCborMap change;
-                change[QStringLiteral("id")] = id;
-                change[QStringLiteral("value")] = QCborValue::fromVariant(newValue);
-                QByteArray cborData;
-                QCborStreamWriter writer(&cborData);
-                QCborValue(change).toCbor(writer);
-                QByteArray packet;
-                packet.append(static_cast<char>(RESP_PROPERTY_CHANGE));
-                packet.append(cborData);
-                sendSlipData(packet);
-            }, this);
-
-            if (!observer) {
-                qDebug() << "Failed to create property observer for ID:" << id;
-                continue;
+        QSet<quint16> ids;
+        QHash<quint16, WatchFilter> filters;
+        // A missing or malformed list clears the watch set
+        readWatchList(payload, payloadLen, &ids, &filters);
+        setSessionWatches(source, ids, filters);
+        qCDebug(lcBridge) << "Now watching property IDs:" << m_sessions.value(source).watchedIds;
+        return;
+    }
+    case CMD_ADD_WATCH: {
+        QSet<quint16> ids;
+        QHash<quint16, WatchFilter> filters;
+        if (readWatchList(payload, payloadLen, &ids, &filters))
+            addSessionWatches(source, ids, filters);
+        return;
+    }
+    case CMD_REMOVE_WATCH: {
+        QSet<quint16> ids;
+        if (readWatchList(payload, payloadLen, &ids, nullptr))
+            removeSessionWatches(source, ids);
+        return;
+    }
+    case CMD_SET_OPTIONS: {
+        ClientSession &session = m_sessions[source];
+        if (payloadLen > 0) {
+            QCborStreamReader reader(payload, payloadLen);
+            if (!reader.isMap() || !reader.enterContainer()) {
+                qCDebug(lcBridge) << "Error: SET_OPTIONS payload is not a CBOR map";
+                return;
+            }
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                qint64 id = -1;
+                QString option;
+                if (!CborValueReader::readKey(reader, &id, &option)) {
+                    reader.next();
+                    continue;
+                }
+                const QVariant value = CborValueReader::readValue(reader);
+                if (option == QLatin1String("wide"))
+                    session.wideIds = value.toBool();
+                else if (option == QLatin1String("packed"))
+                    session.packed = value.toBool();
+                else if (option == QLatin1String("endian"))
+                    session.endianess = value.toString() == QLatin1String("big")
+                                      ? DataDecoder::BigEndian : DataDecoder::LittleEndian;
+                else
+                    qCDebug(lcBridge) << "Unknown option in SET_OPTIONS:" << option;
             }
-
-            m_watchedConnections[id] = observer->connection();
         }
-        qDebug() << "Now watching property IDs:" << m_watchedPropertyIds;
+        sendOptions(source);
         return;
     }
+    case CMD_GET_METRICS:
+        sendMetrics(source);
+        return;
+    case CMD_READ_VALUES:
+        sendValues(source, payload, payloadLen);
+        return;
     case CMD_HEARTBEAT:
         // No action needed
         return;
     default:
-        qDebug() << "Unknown command type:" << cmdType;
+        qCDebug(lcBridge) << "Unknown command type:" << cmdType;
         return;
     }
 }
 
-void GenericQMLBridge::sendPropertyList()
+void GenericQMLBridge::setPackedProperties(const char *records, int size, quint32 source)
 {
-    QCborMap propList;
-    for (auto it = m_propertyNameMap.begin(); it != m_propertyNameMap.end(); ++it) {
-        QQmlProperty prop = m_properties[it.key()];
-        QCborMap entry;
-        entry[QStringLiteral("id")] = it.value();
-        entry[QStringLiteral("type")] = QString::fromUtf8(prop.property().typeName());
-        propList[it.key()] = entry;
-    }
-    QByteArray cbor;
-    QCborStreamWriter writer(&cbor);
-    QCborValue(propList).toCbor(writer);
-    QByteArray packet;
-    packet.append(static_cast<char>(RESP_GET_PROPERTY_LIST));
-    packet.append(cbor);
-    sendSlipData(packet);
-}
+    // Records are [id][value] back to back; the value width comes from the
+    // property's wire type, so parsing stops at the first unknown ID
+    const ClientSession session = m_sessions.value(source);
+    DataDecoder decoder;
+    decoder.setEndianess(session.endianess);
+    const QByteArray data = QByteArray::fromRawData(records, size);
+    const int idSize = session.wideIds ? 2 : 1;
 
-bool GenericQMLBridge::setupSerial(const QString &portName, int baudRate)
-{
-    m_configuredSerialPort = portName;
-    m_configuredBaudRate = baudRate;
+    int offset = 0;
+    while (offset + idSize <= data.size()) {
+        // Two-byte IDs are big-endian like method IDs; endian only applies to values
+        const quint16 id = idSize == 2 ? qFromBigEndian<quint16>(data.constData() + offset)
+                                       : static_cast<quint8>(data.at(offset));
+        offset += idSize;
+        const PropertyEntry *resolved = resolvedProperty(id);
+        if (!resolved || resolved->wireType == WireNone) {
+            qCDebug(lcBridge) << "Unknown or unpackable property in SET_PROPERTY_PACKED:" << id;
+            m_metrics.countUnknownId();
+            return;
+        }
 
-    if (m_serialPort) {
-        if (m_serialPort->isOpen())
-            m_serialPort->close();
-        delete m_serialPort;
+        const PropertyEntry &entry = *resolved;
+        QVariant value;
+        switch (entry.wireType) {
+        case WireBool:
+            value = decoder.decodeBool(data, offset);
+            offset += 1;
+            break;
+        case WireInt32:
+            value = decoder.decodeInt32(data, offset);
+            offset += 4;
+            break;
+        case WireFloat32:
+            value = decoder.decodeFloat(data, offset);
+            offset += 4;
+            break;
+        case WireFloat64:
+            value = decoder.decodeDouble(data, offset);
+            offset += 8;
+            break;
+        case WireNone:
+            break;
+        }
+        if (!value.isValid()) {
+            qCDebug(lcBridge) << "Error: truncated SET_PROPERTY_PACKED record for ID:" << id;
+            return;
+        }
+        // The record size is known, so only this record is dropped
+        if (value.metaType() != entry.metaType && !value.convert(entry.metaType)) {
+            qCDebug(lcBridge) << "Dropping SET_PROPERTY_PACKED record for" << entry.name
+                              << "- it does not convert to" << entry.metaType.name();
+            continue;
+        }
+        stageProperty(id, value);
     }
+}
 
-    m_serialPort = new QSerialPort(this);
-    m_serialPort->setPortName(portName);
-    m_serialPort->setBaudRate(baudRate);
+void GenericQMLBridge::setFlushInterval(int msec)
+{
+    m_changePublisher->setFlushInterval(msec);
+}
 
-    connect(m_serialPort, &QSerialPort::readyRead, this, &GenericQMLBridge::handleSerialData);
-    connect(m_serialPort, &QSerialPort::errorOccurred, this, &GenericQMLBridge::handleSerialError);
+void GenericQMLBridge::setSendQueue(IoWorker::QueuePolicy policy, qint64 limitBytes)
+{
+    m_sendQueuePolicy = policy;
+    QMetaObject::invokeMethod(m_ioWorker, [=]() {
+        m_ioWorker->setSendQueue(policy, limitBytes);
+    }, Qt::BlockingQueuedConnection);
+}
 
-    if (!m_serialPort->open(QIODevice::ReadWrite)) {
-        setLastError(tr("Failed to open serial port: %1").arg(m_serialPort->errorString()));
-        emit serialConnectionStateChanged(false);
+bool GenericQMLBridge::startMetricsEndpoint(const QString &endpoint)
+{
+    delete m_metricsServer;
+    m_metricsServer = new MetricsServer([this]() {
+        return m_metrics.toPrometheus(ioMetrics());
+    }, this);
+    if (!m_metricsServer->listen(endpoint)) {
+        setLastError(tr("Failed to start metrics endpoint: %1").arg(m_metricsServer->errorString()));
         return false;
     }
-
-    emit serialConnectionStateChanged(true);
-    startHeartbeat();
     return true;
 }
 
-void GenericQMLBridge::closeSerial()
+IoMetrics GenericQMLBridge::ioMetrics() const
 {
-    if (m_serialPort->isOpen()) {
-        m_serialPort->close();
-        qDebug() << "Serial port closed";
+    // The worker never waits on the GUI thread, so this cannot deadlock
+    IoMetrics metrics;
+    QMetaObject::invokeMethod(m_ioWorker, [this]() {
+        return m_ioWorker->metrics();
+    }, Qt::BlockingQueuedConnection, &metrics);
+#ifdef Q_OS_LINUX
+    if (m_shmTransport) {
+        metrics.rings << IoMetrics::Ring{ QStringLiteral("shm"), m_shmTransport->usedBytes(),
+                                          m_shmTransport->capacityBytes(), m_shmTransport->dropped() };
     }
+#endif
+    return metrics;
 }
 
-void GenericQMLBridge::handleSerialData()
+void GenericQMLBridge::sendMetrics(quint32 target)
 {
-    QByteArray data = m_serialPort->readAll();
-    m_slipProcessor->onDataReceived(data);
+    QByteArray packet;
+    packet.append(static_cast<char>(RESP_METRICS));
+    QCborStreamWriter writer(&packet);
+    QCborValue(m_metrics.toCbor(ioMetrics())).toCbor(writer);
+    sendSlipDataTo(target, packet);
 }
 
-QStringList GenericQMLBridge::getAvailablePorts() const
+static void appendCborMapHeader(QByteArray &out, quint64 count)
 {
-    QStringList result;
-    const auto ports = QSerialPortInfo::availablePorts();
-    for (const QSerialPortInfo &info : ports) {
-        result << info.portName();
+    // Major type 5 (map) with a definite length
+    if (count < 24) {
+        out.append(static_cast<char>(0xA0 | count));
+    } else if (count <= 0xFF) {
+        out.append(static_cast<char>(0xB8));
+        out.append(static_cast<char>(count));
+    } else if (count <= 0xFFFF) {
+        out.append(static_cast<char>(0xB9));
+        out.append(static_cast<char>(count >> 8));
+        out.append(static_cast<char>(count));
+    } else {
+        out.append(static_cast<char>(0xBA));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.append(static_cast<char>(count >> shift));
     }
-    return result;
 }
 
-bool GenericQMLBridge::setupTCP(int port)
+void GenericQMLBridge::publishChanges(const QList<PropertyChangePublisher::Change> &changes)
 {
-    m_configuredTcpPort = port;
+    m_metrics.countPublished(changes.size());
 
-    if (!m_tcpServer) {
-        m_tcpServer = new QTcpServer(this);
-        connect(m_tcpServer, &QTcpServer::newConnection, this, &GenericQMLBridge::handleTcpNewConnection);
+    // Fan out through the subscription index: collect, per session, the
+    // entries it subscribed to and its watch filters let through. Only
+    // those entries get encoded.
+    const qint64 now = m_watchClock.elapsed();
+    QHash<quint32, QVarLengthArray<qsizetype, 16>> perSession;
+    QVarLengthArray<bool, 64> used(changes.size());
+    for (qsizetype i = 0; i < changes.size(); ++i) {
+        used[i] = false;
+        const auto subscribers = m_subscribers.constFind(changes[i].id);
+        if (subscribers == m_subscribers.constEnd())
+            continue;
+        for (quint32 session : subscribers.value()) {
+            const auto state = m_sessions.find(session);
+            if (state != m_sessions.end()) {
+                if (state->congested) {
+                    state->deferredIds.insert(changes[i].id);
+                    continue;
+                }
+                if (!acceptWatchedChange(*state, changes[i].id, changes[i].value, now))
+                    continue;
+            }
+            perSession[session].append(i);
+            used[i] = true;
+        }
     }
+    encodeChangeEntries(changes, used.constData());
 
-    if (!m_tcpServer->listen(QHostAddress::Any, port)) {
-        setLastError(tr("Error starting TCP server: %1").arg(m_tcpServer->errorString()));
-        return false;
-    }
+    bool fullFrameEncoded = false;
+    for (auto it = perSession.cbegin(); it != perSession.cend(); ++it) {
+        const auto &entries = it.value();
+        const auto session = m_sessions.find(it.key());
+        if (session != m_sessions.end() && session->packed) {
+            sendPackedChanges(it.key(), *session, changes, entries.constData(), entries.size());
+            fullFrameEncoded = false;
+            continue;
+        }
 
-    startHeartbeat();
-    return true;
+        const bool fullFrame = entries.size() == changes.size();
+        if (!fullFrame || !fullFrameEncoded) {
+            encodeChangeFrame(entries.constData(), entries.size());
+            fullFrameEncoded = fullFrame;
+        }
+        writeEncoded(it.key(), m_encodeBuffer);
+    }
 }
 
-void GenericQMLBridge::handleTcpNewConnection()
+void GenericQMLBridge::encodeChangeEntries(const QList<PropertyChangePublisher::Change> &changes,
+                                           const bool *used)
 {
-    QTcpSocket *clientSocket = m_tcpServer->nextPendingConnection();
-    connect(clientSocket, &QTcpSocket::readyRead, this, &GenericQMLBridge::handleTcpData);
-    connect(clientSocket, &QTcpSocket::disconnected, this, &GenericQMLBridge::handleTcpDisconnected);
-    connect(clientSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
-            this, &GenericQMLBridge::handleTcpError);
-
-    SlipProcessor *tcpSlipProcessor = new SlipProcessor(this);
-    connect(tcpSlipProcessor, &SlipProcessor::packetReceived, this, &GenericQMLBridge::processCommand);
-    m_tcpSlipProcessors[clientSocket] = tcpSlipProcessor;
-
-    m_tcpClients.append(clientSocket);
-    emit connectedClientsChanged(m_tcpClients.size());
-    emit tcpConnectionStateChanged(!m_tcpClients.isEmpty());
+    // Encode every {id: value} entry once, back to back in one buffer.
+    // Entries nobody receives are left empty.
+    m_entryBuffer.resize(0);
+    m_entryOffsets.resize(0);
+    {
+        QCborStreamWriter writer(&m_entryBuffer);
+        for (qsizetype i = 0; i < changes.size(); ++i) {
+            m_entryOffsets.append(m_entryBuffer.size());
+            if (used && !used[i])
+                continue;
+            writer.append(quint64(changes[i].id));
+            QCborValue::fromVariant(changes[i].value).toCbor(writer);
+        }
+    }
+    m_entryOffsets.append(m_entryBuffer.size());
+}
 
-    qDebug() << "New TCP client connected. Total clients:" << m_tcpClients.size();
+void GenericQMLBridge::sendPackedChanges(quint32 target, const ClientSession &session,
+                                         const QList<PropertyChangePublisher::Change> &changes,
+                                         const qsizetype *entries, qsizetype count)
+{
+    // Packable values go out as fixed-width records; whatever is left
+    // falls back to a regular CBOR change frame
+    DataEncoder encoder;
+    encoder.setEndianess(session.endianess);
+    QVarLengthArray<qsizetype, 16> rest;
+    m_packetBuffer.resize(0);
+    m_packetBuffer.append(static_cast<char>(RESP_PROPERTY_CHANGE_PACKED));
+    for (qsizetype n = 0; n < count; ++n) {
+        if (!appendPackedRecord(m_packetBuffer, encoder, session.wideIds, changes[entries[n]]))
+            rest.append(entries[n]);
+    }
+    if (m_packetBuffer.size() > 1) {
+        m_encodeBuffer.resize(0);
+        SlipProcessor::appendSlip(m_packetBuffer, m_encodeBuffer);
+        writeEncoded(target, m_encodeBuffer);
+    }
+    if (!rest.isEmpty()) {
+        encodeChangeFrame(rest.constData(), rest.size());
+        writeEncoded(target, m_encodeBuffer);
+    }
 }
 
-void GenericQMLBridge::handleTcpError(QAbstractSocket::SocketError error)
+void GenericQMLBridge::setSessionCongested(quint32 session, bool congested)
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
-    if (!socket) return;
+    auto it = m_sessions.find(session);
+    if (it == m_sessions.end() || it->congested == congested)
+        return;
+    it->congested = congested;
+    if (congested || it->deferredIds.isEmpty())
+        return;
 
-    setLastError(tr("TCP Error: %1").arg(socket->errorString()));
-    
-    if (error != QAbstractSocket::RemoteHostClosedError) {
-        socket->disconnectFromHost();
+    // Catch the client up with the current value of everything that
+    // changed while it was behind
+    const qint64 now = m_watchClock.elapsed();
+    QList<PropertyChangePublisher::Change> changes;
+    for (quint16 id : std::as_const(it->deferredIds)) {
+        if (!it->watchedIds.contains(id))
+            continue;
+        const PropertyEntry *entry = resolvedProperty(id);
+        if (!entry)
+            continue;
+        QVariant value = entry->property.read(entry->object);
+        if (acceptWatchedChange(*it, id, value, now))
+            changes.append({ id, std::move(value) });
     }
+    it->deferredIds.clear();
+    sendChangesTo(session, *it, changes);
 }
 
-void GenericQMLBridge::handleSerialError(QSerialPort::SerialPortError error)
+void GenericQMLBridge::sendChangesTo(quint32 target, ClientSession &session,
+                                     const QList<PropertyChangePublisher::Change> &changes)
 {
-    if (error == QSerialPort::NoError) return;
+    if (changes.isEmpty())
+        return;
 
-    setLastError(tr("Serial Error: %1").arg(m_serialPort->errorString()));
-    
-    if (error != QSerialPort::ResourceError) {
-        emit connectionLost("serial");
-        emit serialConnectionStateChanged(false);
+    encodeChangeEntries(changes);
+    QVarLengthArray<qsizetype, 16> entries;
+    for (qsizetype i = 0; i < changes.size(); ++i)
+        entries.append(i);
+    if (session.packed) {
+        sendPackedChanges(target, session, changes, entries.constData(), entries.size());
+    } else {
+        encodeChangeFrame(entries.constData(), entries.size());
+        writeEncoded(target, m_encodeBuffer);
     }
 }
 
-void GenericQMLBridge::handleTcpDisconnected()
+bool GenericQMLBridge::acceptWatchedChange(ClientSession &session, quint16 id, const QVariant &value, qint64 now)
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
-    if (!socket) return;
+    const auto it = session.filters.find(id);
+    if (it == session.filters.end())
+        return true;
+    WatchFilter &filter = it.value();
 
-    SlipProcessor *slipProcessor = m_tcpSlipProcessors.take(socket);
-    if (slipProcessor) {
-        slipProcessor->deleteLater();
+    // The first value always goes out
+    if (filter.lastSent >= 0) {
+        if (filter.onChange && value == filter.lastValue)
+            return false;
+        if (filter.deadband > 0 || filter.relativeDeadband > 0) {
+            bool isNumber = false;
+            bool wasNumber = false;
+            const double current = value.toDouble(&isNumber);
+            const double last = filter.lastValue.toDouble(&wasNumber);
+            const double threshold = qMax(filter.deadband, filter.relativeDeadband * qAbs(last));
+            if (isNumber && wasNumber && qAbs(current - last) < threshold)
+                return false;
+        }
+        const qint64 due = filter.lastSent + filter.minInterval;
+        if (filter.minInterval > 0 && now < due) {
+            // Send the latest value once the interval is over
+            filter.pending = true;
+            const int wait = int(due - now);
+            if (!m_watchIntervalTimer->isActive() || m_watchIntervalTimer->remainingTime() > wait)
+                m_watchIntervalTimer->start(wait);
+            return false;
+        }
     }
 
-    m_tcpClients.removeOne(socket);
-    socket->deleteLater();
-    
-    emit connectedClientsChanged(m_tcpClients.size());
-    emit tcpConnectionStateChanged(!m_tcpClients.isEmpty());
-    
-    if (m_tcpClients.isEmpty()) {
-        emit connectionLost("tcp");
-    }
+    filter.lastValue = value;
+    filter.lastSent = now;
+    filter.pending = false;
+    return true;
 }
 
-void GenericQMLBridge::checkConnections()
+void GenericQMLBridge::flushPendingWatches()
 {
-    if (m_serialPort && !m_serialPort->isOpen()) {
-        reconnectSerial();
+    const qint64 now = m_watchClock.elapsed();
+    qint64 nextDue = -1;
+    for (auto session = m_sessions.begin(); session != m_sessions.end(); ++session) {
+        QList<PropertyChangePublisher::Change> changes;
+        for (auto filter = session->filters.begin(); filter != session->filters.end(); ++filter) {
+            if (!filter->pending)
+                continue;
+            const qint64 due = filter->lastSent + filter->minInterval;
+            if (due > now) {
+                nextDue = nextDue < 0 ? due : qMin(nextDue, due);
+                continue;
+            }
+            filter->pending = false;
+            const quint16 id = filter.key();
+            if (session->congested) {
+                // Goes out with the catch-up frame instead
+                session->deferredIds.insert(id);
+                continue;
+            }
+            const PropertyEntry *entry = resolvedProperty(id);
+            if (!entry)
+                continue;
+            QVariant value = entry->property.read(entry->object);
+            if (acceptWatchedChange(*session, id, value, now))
+                changes.append({ id, std::move(value) });
+        }
+        sendChangesTo(session.key(), *session, changes);
     }
-
-    sendHeartbeat();
+    if (nextDue >= 0 && (!m_watchIntervalTimer->isActive() || m_watchIntervalTimer->remainingTime() > nextDue - now))
+        m_watchIntervalTimer->start(int(nextDue - now));
 }
 
-void GenericQMLBridge::startHeartbeat()
+void GenericQMLBridge::encodeChangeFrame(const qsizetype *entries, qsizetype count)
 {
-    if (!m_heartbeatTimer->isActive()) {
-        m_heartbeatTimer->start();
+    // Assembles RESP_PROPERTY_CHANGE from the pre-encoded entries into
+    // m_encodeBuffer
+    m_packetBuffer.resize(0);
+    m_packetBuffer.append(static_cast<char>(RESP_PROPERTY_CHANGE));
+    appendCborMapHeader(m_packetBuffer, count);
+    for (qsizetype n = 0; n < count; ++n) {
+        const qsizetype i = entries[n];
+        m_packetBuffer.append(m_entryBuffer.constData() + m_entryOffsets[i],
+                              m_entryOffsets[i + 1] - m_entryOffsets[i]);
     }
+    m_encodeBuffer.resize(0);
+    SlipProcessor::appendSlip(m_packetBuffer, m_encodeBuffer);
 }
 
-void GenericQMLBridge::stopHeartbeat()
+bool GenericQMLBridge::appendPackedRecord(QByteArray &out, const DataEncoder &encoder, bool wideIds,
+                                          const PropertyChangePublisher::Change &change) const
 {
-    m_heartbeatTimer->stop();
+    if (change.id >= m_propertyTable.size() || (!wideIds && change.id > 0xFF))
+        return false;
+    const WireType wireType = m_propertyTable.at(change.id).wireType;
+    if (wireType == WireNone)
+        return false;
+
+    if (wideIds) {
+        // Big-endian regardless of the session's endian option
+        out.append(static_cast<char>(change.id >> 8));
+        out.append(static_cast<char>(change.id));
+    } else {
+        out.append(static_cast<char>(change.id));
+    }
+
+    switch (wireType) {
+    case WireBool:
+        encoder.encodeBool(out, change.value.toBool());
+        break;
+    case WireInt32:
+        encoder.encodeInt32(out, change.value.toInt());
+        break;
+    case WireFloat32:
+        encoder.encodeFloat(out, change.value.toFloat());
+        break;
+    case WireFloat64:
+        encoder.encodeDouble(out, change.value.toDouble());
+        break;
+    case WireNone:
+        break;
+    }
+    return true;
 }
 
-void GenericQMLBridge::sendHeartbeat()
+bool GenericQMLBridge::readWatchList(const char *payload, int size, QSet<quint16> *ids,
+                                     QHash<quint16, WatchFilter> *filters)
 {
-    QByteArray heartbeat;
-    heartbeat.append(static_cast<char>(CMD_HEARTBEAT));
-    
-    sendSlipDataToTcp(heartbeat);
-    
-    for (auto it = m_tcpClients.begin(); it != m_tcpClients.end();) {
-        if ((*it)->state() != QAbstractSocket::ConnectedState) {
-            SlipProcessor *slipProcessor = m_tcpSlipProcessors.take(*it);
-            if (slipProcessor) {
-                slipProcessor->deleteLater();
+    if (size <= 0) {
+        qCDebug(lcBridge) << "Error: watch command missing CBOR array payload";
+        return false;
+    }
+    QCborStreamReader reader(payload, size);
+    if (!reader.isArray() || !reader.enterContainer()) {
+        qCDebug(lcBridge) << "Error: watch command payload is not a CBOR array";
+        return false;
+    }
+
+    // Entries are plain IDs, or maps carrying an ID and filter options
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (reader.isInteger()) {
+            const qint64 id = reader.toInteger();
+            reader.next();
+            // A cast would wrap it onto another property
+            if (id < 0 || id > MaxPropertyId)
+                qCDebug(lcBridge) << "Ignoring out-of-range property ID in watch list:" << id;
+            else
+                ids->insert(quint16(id));
+            continue;
+        }
+        if (!reader.isMap() || !reader.enterContainer()) {
+            reader.next();
+            continue;
+        }
+        qint64 id = -1;
+        WatchFilter filter;
+        while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+            qint64 keyId = -1;
+            QString key;
+            if (!CborValueReader::readKey(reader, &keyId, &key)) {
+                reader.next();
+                continue;
             }
-            (*it)->deleteLater();
-            it = m_tcpClients.erase(it);
-        } else {
-            ++it;
+            const QVariant value = CborValueReader::readValue(reader);
+            if (key == QLatin1String("id"))
+                id = value.toLongLong();
+            else if (key == QLatin1String("deadband"))
+                filter.deadband = qAbs(value.toDouble());
+            else if (key == QLatin1String("deadband_rel"))
+                filter.relativeDeadband = qAbs(value.toDouble());
+            else if (key == QLatin1String("min_interval"))
+                filter.minInterval = qMax<qint64>(value.toLongLong(), 0);
+            else if (key == QLatin1String("on_change"))
+                filter.onChange = value.toBool();
+            else
+                qCDebug(lcBridge) << "Unknown watch option:" << key;
+        }
+        reader.leaveContainer();
+        if (id < 0 || id > MaxPropertyId) {
+            qCDebug(lcBridge) << "Ignoring out-of-range property ID in watch list:" << id;
+            continue;
         }
+        ids->insert(quint16(id));
+        if (filters && (filter.deadband > 0 || filter.relativeDeadband > 0
+                        || filter.minInterval > 0 || filter.onChange))
+            filters->insert(quint16(id), filter);
+    }
+    if (reader.lastError() != QCborError::NoError) {
+        qCDebug(lcBridge) << "Error: malformed watch list:" << reader.lastError().toString();
+        return false;
     }
-    
-    emit connectedClientsChanged(m_tcpClients.size());
-    emit tcpConnectionStateChanged(!m_tcpClients.isEmpty());
+    return true;
 }
 
-void GenericQMLBridge::setLastError(const QString &error)
+void GenericQMLBridge::setSessionWatches(quint32 session, const QSet<quint16> &ids,
+                                         const QHash<quint16, WatchFilter> &filters)
 {
-    m_lastError = error;
-    emit errorOccurred(m_lastError);
+    removeSessionWatches(session, m_sessions[session].watchedIds - ids);
+    addSessionWatches(session, ids, filters);
 }
 
-QString GenericQMLBridge::getLastError() const
+void GenericQMLBridge::addSessionWatches(quint32 session, const QSet<quint16> &ids,
+                                         const QHash<quint16, WatchFilter> &filters)
 {
-    return m_lastError;
+    ClientSession &state = m_sessions[session];
+    for (quint16 id : ids) {
+        if (!state.watchedIds.contains(id)) {
+            if (!subscribe(session, id))
+                continue;
+            state.watchedIds.insert(id);
+        }
+
+        const auto filter = filters.constFind(id);
+        if (filter == filters.constEnd()) {
+            state.filters.remove(id);
+            continue;
+        }
+        // Re-watching keeps the comparison against what was last sent
+        WatchFilter updated = filter.value();
+        const auto current = state.filters.constFind(id);
+        if (current != state.filters.constEnd()) {
+            updated.lastValue = current->lastValue;
+            updated.lastSent = current->lastSent;
+            updated.pending = current->pending;
+        }
+        state.filters.insert(id, updated);
+    }
 }
 
-void GenericQMLBridge::reconnectSerial()
+void GenericQMLBridge::removeSessionWatches(quint32 session, const QSet<quint16> &ids)
 {
-    if (!m_configuredSerialPort.isEmpty()) {
-        setupSerial(m_configuredSerialPort, m_configuredBaudRate);
+    const auto state = m_sessions.find(session);
+    if (state == m_sessions.end())
+        return;
+    for (quint16 id : ids) {
+        if (!state->watchedIds.remove(id))
+            continue;
+        state->filters.remove(id);
+        state->deferredIds.remove(id);
+        unsubscribe(session, id);
     }
 }
 
-void GenericQMLBridge::reconnectTCP()
+bool GenericQMLBridge::subscribe(quint32 session, quint16 id)
 {
-    if (m_configuredTcpPort > 0) {
-        setupTCP(m_configuredTcpPort);
+    QList<quint32> &subscribers = m_subscribers[id];
+    if (subscribers.isEmpty()) {
+        // First subscriber: connect the property once for every session
+        const PropertyEntry *entry = resolvedProperty(id);
+        if (!entry) {
+            m_metrics.countUnknownId();
+            m_subscribers.remove(id);
+            return false;
+        }
+
+        if (!m_propertyObserver->watch(id, entry->object, entry->property)) {
+            qCDebug(lcBridge) << "Failed to observe property ID:" << id;
+            m_subscribers.remove(id);
+            return false;
+        }
     }
+    subscribers.append(session);
+    return true;
 }
 
-void GenericQMLBridge::handleTcpData()
+void GenericQMLBridge::unsubscribe(quint32 session, quint16 id)
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
-    if (!socket) {
-        qDebug() << "Error: Could not get sender socket";
+    auto it = m_subscribers.find(id);
+    if (it == m_subscribers.end())
         return;
+
+    it.value().removeOne(session);
+    if (it.value().isEmpty()) {
+        m_subscribers.erase(it);
+        // A cached value stays observed
+        if (!m_valueCache.contains(id))
+            m_propertyObserver->unwatch(id);
     }
+}
+
+void GenericQMLBridge::removeSession(quint32 session)
+{
+    const ClientSession state = m_sessions.take(session);
+    for (quint16 id : state.watchedIds)
+        unsubscribe(session, id);
+}
+
+void GenericQMLBridge::writeEncoded(quint32 session, QByteArrayView encoded)
+{
+    // Session 0 stands for commands issued locally: reply on every transport
+    m_ioWorker->post(session, encoded);
+}
 
-    QByteArray data = socket->readAll();
-    if (data.isEmpty()) {
-        qDebug() << "Warning: Received empty data from TCP client";
+void GenericQMLBridge::sendSlipDataTo(quint32 session, QByteArrayView data)
+{
+    m_encodeBuffer.resize(0);
+    SlipProcessor::appendSlip(data, m_encodeBuffer);
+    writeEncoded(session, m_encodeBuffer);
+}
+
+bool GenericQMLBridge::writeProperty(const PropertyEntry &entry, QVariant &value)
+{
+    if (!entry.object)
+        return false;
+    // Through the cached QQmlProperty, so a remote write removes a binding
+    // on the property like any imperative QML assignment; a metacall would
+    // leave it to overwrite the value on its next evaluation. The value
+    // was already built as the property's metatype, so no conversion runs.
+    return entry.qmlProperty.write(value);
+}
+
+void GenericQMLBridge::stageProperty(quint16 id, QVariant &value)
+{
+    if (!m_staging) {
+        const PropertyEntry &entry = m_propertyTable.at(id);
+        bool success = writeProperty(entry, value);
+        if (success)
+            rememberWrite(id, value);
+        qCDebug(lcBridge) << "Property updated:" << entry.name << "=" << value << "Success:" << success;
         return;
     }
 
-    SlipProcessor *slipProcessor = m_tcpSlipProcessors.value(socket);
-    if (slipProcessor) {
-        slipProcessor->onDataReceived(data);
+    if (m_stagedValues.size() < m_propertyTable.size()) {
+        m_stagedValues.resize(m_propertyTable.size());
+        m_stagedMask.resize(m_propertyTable.size());
+    }
+    // Not read off the value: an invalid QVariant (CBOR null for a var
+    // property) is a legitimate staged write
+    if (m_stagedMask.testBit(id)) {
+        m_metrics.countCoalesced();
     } else {
-        qDebug() << "Error: No SlipProcessor found for TCP client";
+        m_stagedMask.setBit(id);
+        m_stagedIds.append(id);
     }
+    m_stagedValues[id] = std::move(value);
 }
 
-GenericQMLBridge::~GenericQMLBridge()
+void GenericQMLBridge::rememberWrite(quint16 id, const QVariant &value)
+{
+    // Only hot reload needs them back
+    if (!m_hotReload)
+        return;
+    if (m_lastWritten.size() <= id)
+        m_lastWritten.resize(id + 1);
+    m_lastWritten[id] = value;
+}
+
+void GenericQMLBridge::flushStagedProperties()
 {
-    stopHeartbeat();
-    
-    if (m_serialPort) {
-        if (m_serialPort->isOpen())
-            m_serialPort->close();
-        delete m_serialPort;
+    for (quint16 id : std::as_const(m_stagedIds)) {
+        QVariant value = std::exchange(m_stagedValues[id], QVariant());
+        m_stagedMask.clearBit(id);
+        // The scene may have been rescanned since the write was staged
+        const PropertyEntry *entry = resolvedProperty(id);
+        if (!entry)
+            continue;
+        bool success = writeProperty(*entry, value);
+        if (success)
+            rememberWrite(id, value);
+        qCDebug(lcBridge) << "Property updated:" << entry->name << "=" << value << "Success:" << success;
     }
+    m_stagedIds.clear();
+}
 
-    for (auto it = m_tcpSlipProcessors.begin(); it != m_tcpSlipProcessors.end(); ++it) {
-        if (it.value()) {
-            it.value()->deleteLater();
-        }
+void GenericQMLBridge::sendOptions(quint32 target)
+{
+    const ClientSession session = m_sessions.value(target);
+    QCborMap options;
+    options[QStringLiteral("wide")] = session.wideIds;
+    options[QStringLiteral("packed")] = session.packed;
+    options[QStringLiteral("endian")] = session.endianess == DataDecoder::BigEndian
+                                      ? QStringLiteral("big") : QStringLiteral("little");
+    QByteArray packet;
+    packet.append(static_cast<char>(RESP_OPTIONS));
+    QCborStreamWriter writer(&packet);
+    QCborValue(options).toCbor(writer);
+    sendSlipDataTo(target, packet);
+}
+
+void GenericQMLBridge::invalidatePropertyList()
+{
+    m_propertyListFrames.clear();
+    m_schemaFrame.clear();
+}
+
+QCborMap GenericQMLBridge::propertyListEntry(quint16 id) const
+{
+    const PropertyEntry &prop = m_propertyTable.at(id);
+    QCborMap entry;
+    entry[QStringLiteral("id")] = qint64(id);
+    entry[QStringLiteral("type")] = QString::fromUtf8(prop.typeName);
+    if (prop.wireType != WireNone)
+        entry[QStringLiteral("wire")] = wireTypeName(prop.wireType);
+    return entry;
+}
+
+QCborMap GenericQMLBridge::methodListEntry(quint16 id) const
+{
+    const MethodEntry &method = m_methodTable.at(id);
+    QCborArray params;
+    for (const QByteArray &type : method.parameterTypeNames)
+        params.append(QString::fromUtf8(type));
+    QCborMap entry;
+    entry[QStringLiteral("id")] = qint64(id);
+    entry[QStringLiteral("type")] = QStringLiteral("method");
+    entry[QStringLiteral("params")] = params;
+    return entry;
+}
+
+void GenericQMLBridge::buildPropertyList()
+{
+    QCborMap propList;
+    for (qsizetype id = 0; id < m_propertyTable.size(); ++id) {
+        const PropertyEntry &prop = m_propertyTable.at(id);
+        if (!prop.name.isEmpty())
+            propList[prop.name] = propertyListEntry(quint16(id));
+    }
+    for (qsizetype id = 0; id < m_methodTable.size(); ++id) {
+        const MethodEntry &method = m_methodTable.at(id);
+        if (!method.name.isEmpty())
+            propList[method.name] = methodListEntry(quint16(id));
+    }
+    QByteArray packet;
+    packet.append(static_cast<char>(RESP_GET_PROPERTY_LIST));
+    {
+        QCborStreamWriter writer(&packet);
+        QCborValue(propList).toCbor(writer);
     }
-    m_tcpSlipProcessors.clear();
 
-    for (QTcpSocket* socket : m_tcpClients) {
-        if (socket) {
-            socket->disconnectFromHost();
-            if (socket->state() != QAbstractSocket::UnconnectedState)
-                socket->waitForDisconnected();
-            socket->deleteLater();
-        }
+    // First 64 bits of the SHA-1 of the response, stable across restarts
+    const QByteArray digest = QCryptographicHash::hash(packet, QCryptographicHash::Sha1);
+    m_schemaHash = qFromBigEndian<quint64>(digest.constData());
+
+    QByteArray hashPacket;
+    hashPacket.append(static_cast<char>(RESP_SCHEMA_HASH));
+    {
+        QCborStreamWriter writer(&hashPacket);
+        writer.append(m_schemaHash);
     }
-    m_tcpClients.clear();
+
+    // Both frames are kept SLIP-encoded and go out with a single write
+    m_schemaFrame = SlipProcessor::encodeSlip(hashPacket);
+    m_propertyListFrames = SlipProcessor::encodeSlip(packet);
+    m_propertyListFrames += m_schemaFrame;
 }
 
-void GenericQMLBridge::sendSlipData(const QByteArray &data)
+void GenericQMLBridge::sendPropertyList(quint32 target, const quint64 *clientHash)
 {
-    QByteArray encodedData = SlipProcessor::encodeSlip(data);
-    
-    if (m_serialPort && m_serialPort->isOpen()) {
-        m_serialPort->write(encodedData);
+    m_sessions[target].schemaKnown = true;
+    if (m_propertyListFrames.isEmpty())
+        buildPropertyList();
+
+    if (clientHash && *clientHash == m_schemaHash)
+        writeEncoded(target, m_schemaFrame);
+    else
+        writeEncoded(target, m_propertyListFrames);
+}
+
+void GenericQMLBridge::scheduleInboundDrain()
+{
+    // Drain once per frame while the scene is on screen, otherwise now
+    if (m_window && m_window->isExposed()) {
+        m_window->update();
+        m_drainFallbackTimer->start();
+        return;
     }
-    
-    for (QTcpSocket* client : m_tcpClients) {
-        if (client && client->state() == QAbstractSocket::ConnectedState) {
-            client->write(encodedData);
+    drainInbound();
+}
+
+void GenericQMLBridge::drainInbound()
+{
+    m_drainFallbackTimer->stop();
+    SpscFrameRing &inbound = m_ioWorker->inbound();
+    inbound.clearWake();
+    m_staging = true;
+    inbound.drain([this](quint32 session, quint32 kind, QByteArrayView payload) {
+        switch (kind) {
+        case SpscFrameRing::Frame:
+            processCommand(payload, session);
+            break;
+        case SpscFrameRing::SessionOpened:
+            m_sessions.insert(session, ClientSession());
+            break;
+        case SpscFrameRing::SessionClosed:
+            removeSession(session);
+            break;
         }
-    }
+    });
+    applySharedMemoryUpdates();
+    m_staging = false;
+    flushStagedProperties();
 }
 
-void GenericQMLBridge::sendSlipDataToSerial(const QByteArray &data)
+void GenericQMLBridge::applySharedMemoryUpdates()
 {
-    if (m_serialPort && m_serialPort->isOpen()) {
-        QByteArray encodedData = SlipProcessor::encodeSlip(data);
-        m_serialPort->write(encodedData);
+#ifdef Q_OS_LINUX
+    if (!m_shmTransport)
+        return;
+    m_shmTransport->drain([this](const ShmUpdateRecord &record) {
+        const PropertyEntry *resolved = resolvedProperty(record.id);
+        if (!resolved) {
+            m_metrics.countUnknownId();
+            return;
+        }
+        const PropertyEntry &entry = *resolved;
+        // Records carry a bool or a number, so they only go to properties
+        // of the packable types; anything else would be reset
+        if (entry.wireType == WireNone) {
+            qCDebug(lcBridge) << "Ignoring shared-memory record for non-numeric property" << entry.name;
+            return;
+        }
+        bool ok = true;
+        QVariant value;
+        switch (record.type) {
+        case ShmUpdateBool:
+            value = CborValueReader::numberAs(record.value.i != 0, entry.metaType, &ok);
+            break;
+        case ShmUpdateInt:
+            value = CborValueReader::numberAs(qint64(record.value.i), entry.metaType, &ok);
+            break;
+        case ShmUpdateDouble:
+            value = CborValueReader::numberAs(record.value.d, entry.metaType, &ok);
+            break;
+        default:
+            qCDebug(lcBridge) << "Unknown shared-memory record type" << record.type << "for ID:" << record.id;
+            return;
+        }
+        if (!ok) {
+            qCDebug(lcBridge) << "Ignoring shared-memory record for" << entry.name
+                              << "- its value does not convert to" << entry.metaType.name();
+            return;
+        }
+        stageProperty(record.id, value);
+    });
+#endif
+}
+
+bool GenericQMLBridge::setupSerial(const QString &portName, int baudRate)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_ioWorker, [=]() {
+        return m_ioWorker->addSerial(portName, baudRate);
+    }, Qt::BlockingQueuedConnection, &ok);
+    // Other ports may already be open, so a failure here changes nothing
+    if (ok)
+        m_serialConnected = true;
+    return ok;
+}
+
+bool GenericQMLBridge::setupTCP(int port)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_ioWorker, [=]() {
+        return m_ioWorker->addTcp(port);
+    }, Qt::BlockingQueuedConnection, &ok);
+    return ok;
+}
+
+bool GenericQMLBridge::setupLocal(const QString &serverName)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_ioWorker, [=]() {
+        return m_ioWorker->addLocal(serverName);
+    }, Qt::BlockingQueuedConnection, &ok);
+    return ok;
+}
+
+bool GenericQMLBridge::setupSharedMemory(const QString &name, quint32 capacity)
+{
+#ifdef Q_OS_LINUX
+    delete m_shmTransport;
+    m_shmTransport = new ShmTransport(this);
+    if (!m_shmTransport->open(name, capacity)) {
+        setLastError(tr("Failed to open shared-memory ring: %1").arg(m_shmTransport->errorString()));
+        delete m_shmTransport;
+        m_shmTransport = nullptr;
+        return false;
     }
+    connect(m_shmTransport, &ShmTransport::updatesReady, this, &GenericQMLBridge::scheduleInboundDrain);
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(capacity);
+    setLastError(tr("The shared-memory transport is only available on Linux"));
+    return false;
+#endif
 }
 
-void GenericQMLBridge::sendSlipDataToTcp(const QByteArray &data)
+void GenericQMLBridge::closeSerial()
 {
-    QByteArray encodedData = SlipProcessor::encodeSlip(data);
-    for (QTcpSocket* client : m_tcpClients) {
-        if (client && client->state() == QAbstractSocket::ConnectedState) {
-            client->write(encodedData);
-        }
+    QMetaObject::invokeMethod(m_ioWorker, &IoWorker::closeSerial, Qt::QueuedConnection);
+}
+
+void GenericQMLBridge::reconnectSerial()
+{
+    QMetaObject::invokeMethod(m_ioWorker, &IoWorker::reconnectSerial, Qt::QueuedConnection);
+}
+
+void GenericQMLBridge::reconnectTCP()
+{
+    QMetaObject::invokeMethod(m_ioWorker, &IoWorker::reconnectTCP, Qt::QueuedConnection);
+}
+
+QStringList GenericQMLBridge::getAvailablePorts() const
+{
+    QStringList result;
+    const auto ports = QSerialPortInfo::availablePorts();
+    for (const QSerialPortInfo &info : ports) {
+        result << info.portName();
     }
+    return result;
+}
+
+void GenericQMLBridge::setLastError(const QString &error)
+{
+    m_lastError = error;
+    emit errorOccurred(m_lastError);
+}
+
+QString GenericQMLBridge::getLastError() const
+{
+    return m_lastError;
+}
+
+GenericQMLBridge::~GenericQMLBridge()
+{
+    QMetaObject::invokeMethod(m_ioWorker, &IoWorker::shutdown, Qt::BlockingQueuedConnection);
+    m_ioThread.quit();
+    m_ioThread.wait();
+}
+
+void GenericQMLBridge::sendSlipData(QByteArrayView data)
+{
+    sendSlipDataTo(IoWorker::AllSessions, data);
+}
+
+void GenericQMLBridge::sendSlipDataToSerial(QByteArrayView data)
+{
+    sendSlipDataTo(IoWorker::AllSerialSessions, data);
+}
+
+void GenericQMLBridge::sendSlipDataToTcp(QByteArrayView data)
+{
+    sendSlipDataTo(IoWorker::AllSocketSessions, data);
 }
@@ -13,7 +13,23 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QTimer>
+#include <QThread>
+#include <QPointer>
+#include <QBitArray>
+#include <QQuickWindow>
+#include <QElapsedTimer>
 #include "slipprocessor.h"
+#include "datadecoder.hpp"
+#include "propertychangepublisher.h"
+#include "metrics.h"
+#include "ioworker.h"
+#include "lastvaluecache.hpp"
+
+class MetricsServer;
+class DataEncoder;
+class ShmTransport;
+class QmlPropertyObserver;
+class QCborStreamReader;
 
 class GenericQMLBridge : public QObject
 {
@@ -25,40 +41,84 @@ class GenericQMLBridge : public QObject
 
 public:
     enum ProtocolCommand {
-        CMD_GET_PROPERTY_LIST = 0x01,
-        CMD_SET_PROPERTY      = 0x02,
-        CMD_INVOKE_METHOD     = 0x03,
-        CMD_HEARTBEAT         = 0x04,
-        CMD_WATCH_PROPERTY    = 0x20
+        CMD_GET_PROPERTY_LIST   = 0x01,
+        CMD_SET_PROPERTY        = 0x02,
+        CMD_INVOKE_METHOD       = 0x03,
+        CMD_HEARTBEAT           = 0x04,
+        CMD_SET_OPTIONS         = 0x05,
+        CMD_GET_METRICS         = 0x06,
+        CMD_INVOKE_BATCH        = 0x07,
+        CMD_READ_VALUES         = 0x08,
+        CMD_SET_PROPERTY_PACKED = 0x12,
+        CMD_WATCH_PROPERTY      = 0x20,
+        CMD_ADD_WATCH           = 0x21,
+        CMD_REMOVE_WATCH        = 0x22
     };
     Q_ENUM(ProtocolCommand)
 
     enum ProtocolResponse {
-        RESP_GET_PROPERTY_LIST = 0x81,
-        RESP_PROPERTY_CHANGE   = 0x82,
+        RESP_GET_PROPERTY_LIST      = 0x81,
+        RESP_PROPERTY_CHANGE        = 0x82,
+        RESP_OPTIONS                = 0x83,
+        RESP_SCHEMA_HASH            = 0x84,
+        RESP_METRICS                = 0x85,
+        RESP_SCHEMA_DELTA           = 0x86,
+        RESP_VALUES                 = 0x87,
+        RESP_PROPERTY_CHANGE_PACKED = 0x92,
     };
     Q_ENUM(ProtocolResponse)
 
+    // Fixed-width value encodings used by the packed frames
+    enum WireType {
+        WireNone,    // not packable, CBOR only
+        WireBool,    // 1 byte, 0 or 1
+        WireInt32,   // 4 bytes, two's complement
+        WireFloat32, // 4 bytes, IEEE 754 single precision
+        WireFloat64  // 8 bytes, IEEE 754 double precision
+    };
+
+    // Property and method IDs are 16 bit on the wire
+    static constexpr int MaxPropertyId = 0xFFFF;
+
     explicit GenericQMLBridge(QObject *parent = nullptr);
     virtual ~GenericQMLBridge();
 
     bool loadQML(const QString &qmlFile);
+    // Each call adds an endpoint; any number of them can be open at once
     bool setupSerial(const QString &portName, int baudRate);
     bool setupTCP(int port);
+    bool setupLocal(const QString &serverName);
+    // Linux only: shared-memory ring of property updates for co-located
+    // producers, drained once per frame (see shmupdatering.hpp)
+    bool setupSharedMemory(const QString &name, quint32 capacity = 65536);
     void discoverProperties();
-    void processCommand(const QByteArray &data);
+    // Schema cache file, keyed by a hash of the QML sources next to the
+    // loaded file, or of everything below sourceRoot if given. Set before
+    // loadQML(); an empty path disables the cache.
+    void setDiscoveryCache(const QString &path, const QString &sourceRoot = QString());
+    // Reloads the scene in place when the loaded QML file or a file next
+    // to it changes, keeping IDs, values written by clients and watches
+    void setHotReload(bool enabled);
+    Q_INVOKABLE void reloadQML();
+    void setFlushInterval(int msec);
+    // Bounds what each client may have waiting to be sent; see IoWorker::QueuePolicy
+    void setSendQueue(IoWorker::QueuePolicy policy, qint64 limitBytes);
+    // Serves Prometheus text on a localhost TCP port or a local socket name
+    bool startMetricsEndpoint(const QString &endpoint);
+    void processCommand(QByteArrayView data, quint32 source = 0);
+    int propertyId(const QString &name) const;
     Q_INVOKABLE QStringList getAvailablePorts() const;
-    Q_INVOKABLE bool isSerialConnected() const { return m_serialPort && m_serialPort->isOpen(); }
-    Q_INVOKABLE bool isTcpConnected() const { return !m_tcpClients.isEmpty(); }
-    Q_INVOKABLE int connectedClients() const { return m_tcpClients.size(); }
+    Q_INVOKABLE bool isSerialConnected() const { return m_serialConnected; }
+    Q_INVOKABLE bool isTcpConnected() const { return m_connectedClients > 0; }
+    Q_INVOKABLE int connectedClients() const { return m_connectedClients; }
     Q_INVOKABLE void closeSerial();
     Q_INVOKABLE QString getLastError() const;
     Q_INVOKABLE void reconnectSerial();
     Q_INVOKABLE void reconnectTCP();
     
-    void sendSlipData(const QByteArray &data);
-    void sendSlipDataToSerial(const QByteArray &data);
-    void sendSlipDataToTcp(const QByteArray &data);
+    void sendSlipData(QByteArrayView data);
+    void sendSlipDataToSerial(QByteArrayView data);
+    void sendSlipDataToTcp(QByteArrayView data);
 
 signals:
     void tcpConnectionStateChanged(bool connected);
@@ -67,41 +127,228 @@ signals:
     void connectedClientsChanged(int count);
     void connectionLost(const QString &type);
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
-    void handleSerialData();
-    void handleSerialError(QSerialPort::SerialPortError error);
-    void handleTcpNewConnection();
-    void handleTcpData();
-    void handleTcpDisconnected();
-    void handleTcpError(QAbstractSocket::SocketError error);
-    void checkConnections();
+    void scheduleInboundDrain();
+    void drainInbound();
 
 private:
     QQmlApplicationEngine *m_engine;
     QObject *m_rootObject;
-    QSerialPort *m_serialPort;
-    QTcpServer *m_tcpServer;
-    QList<QTcpSocket*> m_tcpClients;
-    QHash<QString, QQmlProperty> m_properties;
-    QHash<QString, QMetaMethod> m_methods;
-    QHash<quint8, QString> m_propertyIdMap;
-    QHash<QString, quint8> m_propertyNameMap;
+    QPointer<QQuickWindow> m_window;
+    // Transports, SLIP decoding and session bookkeeping run on m_ioThread
+    QThread m_ioThread;
+    IoWorker *m_ioWorker;
+    bool m_serialConnected;
+    int m_connectedClients;
+    QTimer *m_drainFallbackTimer;
+    // ID <-> name assignments; kept across rescans so IDs stay stable
+    QHash<quint16, QString> m_propertyIdMap;
+    QHash<QString, quint16> m_propertyNameMap;
+    int m_nextPropertyId = 0;
+    // Dense property table indexed by property ID, with everything a write
+    // needs resolved up front. Entries of names missing from the current
+    // scene have no name. Entries restored from the discovery cache are
+    // pending until resolvedProperty() first looks their object up.
+    struct PropertyEntry {
+        QString name;
+        QString path;            // objectName chain from the root object
+        QByteArray typeName;
+        QObject *object = nullptr;
+        QMetaProperty property;
+        QQmlProperty qmlProperty;  // writes go through it, see writeProperty()
+        int propertyIndex = -1;
+        QMetaType metaType;
+        WireType wireType = WireNone;
+        bool pending = false;
+    };
+    QList<PropertyEntry> m_propertyTable;
+    // Methods have their own ID space and table, filled the same way. The
+    // metacall index and parameter types are resolved at discovery, so a
+    // call converts its CBOR arguments straight into the parameter types.
+    QHash<quint16, QString> m_methodIdMap;
+    QHash<QString, quint16> m_methodNameMap;
+    int m_nextMethodId = 0;
+    struct MethodEntry {
+        QString name;
+        QString path;
+        QObject *object = nullptr;
+        QMetaMethod method;
+        int methodIndex = -1;
+        QByteArray signature;
+        QList<QMetaType> parameterTypes;
+        QList<QByteArray> parameterTypeNames;
+        bool pending = false;
+    };
+    QList<MethodEntry> m_methodTable;
+    QString m_discoveryCachePath;
+    QString m_discoverySourceRoot;
+    quint64 m_sourceHash = 0;
+    // objectName paths looked up by lazy resolution
+    QHash<QString, QPointer<QObject>> m_objectPaths;
+    bool m_rescanQueued = false;
+    // Every object discovery visited, so a subtree can be added when it
+    // appears and dropped when it goes away without walking the rest
+    struct DiscoveredObject {
+        QObject *parent = nullptr;
+        QString path;
+        QList<QObject *> children;
+        QList<quint16> propertyIds;
+        QList<quint16> methodIds;
+        QList<QMetaObject::Connection> connections;
+    };
+    QHash<QObject *, DiscoveredObject> m_discovered;
+    QString m_qmlFile;
+    bool m_hotReload = false;
+    static constexpr int ReloadDelayMs = 100;
+    QFileSystemWatcher *m_qmlWatcher = nullptr;
+    QTimer *m_reloadTimer = nullptr;
+    // Last value each client write set, indexed by property ID; restored
+    // after a hot reload
+    QList<QVariant> m_lastWritten;
+    // Objects whose children changed since the last incremental pass
+    QSet<QObject *> m_dirtyObjects;
+    QTimer *m_discoveryTimer;
+    // Pending RESP_SCHEMA_DELTA content
+    QList<quint16> m_addedPropertyIds;
+    QList<quint16> m_addedMethodIds;
+    QStringList m_removedNames;
+    // Cached, SLIP-encoded RESP_GET_PROPERTY_LIST + RESP_SCHEMA_HASH frames;
+    // rebuilt on the first request after rediscovery
+    QByteArray m_propertyListFrames;
+    QByteArray m_schemaFrame;
+    quint64 m_schemaHash = 0;
     QString m_lastError;
-    QTimer *m_heartbeatTimer;
-    QString m_configuredSerialPort;
-    int m_configuredBaudRate;
-    int m_configuredTcpPort;
-    SlipProcessor *m_slipProcessor;
-    QHash<QTcpSocket*, SlipProcessor*> m_tcpSlipProcessors;
-    QSet<quint8> m_watchedPropertyIds;
-    QHash<quint8, QMetaObject::Connection> m_watchedConnections;
+    PropertyChangePublisher *m_changePublisher;
+    BridgeMetrics m_metrics;
+    MetricsServer *m_metricsServer = nullptr;
+    ShmTransport *m_shmTransport = nullptr;
+    IoWorker::QueuePolicy m_sendQueuePolicy = IoWorker::CollapseLatest;
+    // Per-watch filter from an extended CMD_WATCH_PROPERTY entry, compared
+    // against the last value sent to that client
+    struct WatchFilter {
+        double deadband = 0;        // absolute
+        double relativeDeadband = 0; // fraction of the last sent value
+        qint64 minInterval = 0;     // ms between two notifications
+        bool onChange = false;      // drop notifications that repeat the value
+        QVariant lastValue;
+        qint64 lastSent = -1;       // m_watchClock time, -1 before the first
+        bool pending = false;       // held back by minInterval
+    };
+    // Per-session subscription state, keyed by the session ID assigned by
+    // the I/O worker. Session 0 stands for commands issued locally.
+    struct ClientSession {
+        QSet<quint16> watchedIds;
+        bool wideIds = false;
+        // Packed mode: changes go out as RESP_PROPERTY_CHANGE_PACKED with
+        // fixed-width fields in this byte order
+        bool packed = false;
+        DataDecoder::Endianess endianess = DataDecoder::LittleEndian;
+        // Set while the client's send queue is over its limit; changes are
+        // held back as IDs and sent with their latest value once it drains
+        bool congested = false;
+        QSet<quint16> deferredIds;
+        // Only watches that asked for filtering have an entry
+        QHash<quint16, WatchFilter> filters;
+        // Has fetched the property list, so it gets RESP_SCHEMA_DELTA
+        bool schemaKnown = false;
+    };
+    QHash<quint32, ClientSession> m_sessions;
+    // Fan-out index: property ID -> sessions subscribed to it
+    QHash<quint16, QList<quint32>> m_subscribers;
+    // Connects the NOTIFY signal of every property with a subscriber or
+    // a cached value
+    QmlPropertyObserver *m_propertyObserver;
+    // Values served by CMD_READ_VALUES. A property is read once, on its
+    // first bulk read, and from then on kept current by the observer.
+    LastValueCache m_valueCache;
+    QElapsedTimer m_watchClock;
+    // Sends values held back by a minimum interval once it has passed
+    QTimer *m_watchIntervalTimer;
+    // Inbound writes staged while drainInbound() runs, indexed by property
+    // ID, and applied once at its end: a burst of SETs to one property
+    // between two frames costs a single write and binding update
+    bool m_staging = false;
+    QList<QVariant> m_stagedValues;
+    QBitArray m_stagedMask;
+    QList<quint16> m_stagedIds;
+
+    QByteArray m_encodeBuffer;
+    QByteArray m_packetBuffer;
+    QByteArray m_entryBuffer;
+    QList<qsizetype> m_entryOffsets;
 
-    void scanObjectProperties(QObject *obj, const QString &prefix = "");
-    void sendPropertyList();
+    void dispatchCommand(QByteArrayView data, quint32 source);
+    IoMetrics ioMetrics() const;
+    void sendMetrics(quint32 target);
+    void sendValues(quint32 target, const char *payload, int size);
+    const LastValueCache::Entry &cachedValue(quint16 id, const PropertyEntry &entry);
+    void scanObjectProperties(QObject *obj, const QString &prefix = "", QObject *parent = nullptr);
+    void trackRestoredObject(QObject *obj, const QString &path, QObject *parent,
+                             const QHash<QString, DiscoveredObject> &restored);
+    void trackObject(QObject *obj, DiscoveredObject node);
+    void markDiscoveryDirty(QObject *obj);
+    void processDiscoveryChanges();
+    void forgetObject(QObject *obj, bool destroyed);
+    void collectAddedEntries(QObject *obj);
+    void sendSchemaDelta();
+    void reattachWatches();
+    QObject *createScene(const QString &qmlFile);
+    void attachScene(QObject *root);
+    void watchQmlSources();
+    void rememberWrite(quint16 id, const QVariant &value);
+    QCborMap propertyListEntry(quint16 id) const;
+    QCborMap methodListEntry(quint16 id) const;
+    int assignPropertyId(const QString &propName);
+    int assignMethodId(const QString &methodName);
+    void clearDiscovery();
+    bool restoreDiscoveryCache();
+    void saveDiscoveryCache();
+    QObject *objectAtPath(const QString &path);
+    PropertyEntry *resolvedProperty(int id);
+    MethodEntry *resolvedMethod(int id);
+    void scheduleRescan();
+    int addMethod(QObject *obj, const QMetaMethod &method, const QString &prefix);
+    bool invokeMethod(int id, QCborStreamReader *args);
+    void invokeBatch(const char *payload, int size);
+    void invalidatePropertyList();
+    void buildPropertyList();
+    void sendPropertyList(quint32 target = 0, const quint64 *clientHash = nullptr);
+    void sendOptions(quint32 target);
+    bool writeProperty(const PropertyEntry &entry, QVariant &value);
+    void stageProperty(quint16 id, QVariant &value);
+    void flushStagedProperties();
+    void publishChanges(const QList<PropertyChangePublisher::Change> &changes);
+    void encodeChangeEntries(const QList<PropertyChangePublisher::Change> &changes,
+                             const bool *used = nullptr);
+    void sendChangesTo(quint32 target, ClientSession &session,
+                       const QList<PropertyChangePublisher::Change> &changes);
+    bool acceptWatchedChange(ClientSession &session, quint16 id, const QVariant &value, qint64 now);
+    void flushPendingWatches();
+    void encodeChangeFrame(const qsizetype *entries, qsizetype count);
+    void sendPackedChanges(quint32 target, const ClientSession &session,
+                           const QList<PropertyChangePublisher::Change> &changes,
+                           const qsizetype *entries, qsizetype count);
+    void setSessionCongested(quint32 session, bool congested);
+    bool appendPackedRecord(QByteArray &out, const DataEncoder &encoder, bool wideIds,
+                            const PropertyChangePublisher::Change &change) const;
+    void setPackedProperties(const char *records, int size, quint32 source);
+    void applySharedMemoryUpdates();
+    bool readWatchList(const char *payload, int size, QSet<quint16> *ids,
+                       QHash<quint16, WatchFilter> *filters);
+    void setSessionWatches(quint32 session, const QSet<quint16> &ids,
+                           const QHash<quint16, WatchFilter> &filters = {});
+    void addSessionWatches(quint32 session, const QSet<quint16> &ids,
+                           const QHash<quint16, WatchFilter> &filters);
+    void removeSessionWatches(quint32 session, const QSet<quint16> &ids);
+    bool subscribe(quint32 session, quint16 id);
+    void unsubscribe(quint32 session, quint16 id);
+    void removeSession(quint32 session);
+    void writeEncoded(quint32 session, QByteArrayView encoded);
+    void sendSlipDataTo(quint32 session, QByteArrayView data);
     QVariant parseValue(const QByteArray &data, QMetaType::Type expectedType);
     void sendEvent(const QString &eventName, const QVariantList &args = {});
     void setLastError(const QString &error);
-    void startHeartbeat();
-    void stopHeartbeat();
-    void sendHeartbeat();
 };
@@ -0,0 +1,401 @@
+#include "ioworker.h"
+#include "logging.h"
+
+#include <QDebug>
+
+IoWorker::IoWorker(QObject *parent)
+    : QObject(parent)
+    , m_inbound(1 << 20)
+    , m_outbound(1 << 22)
+    , m_heartbeatTimer(new QTimer(this))
+    , m_nextSession(1)
+    , m_droppedInbound(0)
+    , m_droppedOutbound(0)
+    , m_queuePolicy(CollapseLatest)
+    , m_queueLimit(1 << 20)
+{
+    m_heartbeatTimer->setInterval(5000);
+    connect(m_heartbeatTimer, &QTimer::timeout, this, &IoWorker::checkConnections);
+}
+
+IoWorker::~IoWorker()
+{
+    shutdown();
+}
+
+void IoWorker::setHeartbeatPacket(const QByteArray &packet)
+{
+    m_heartbeatFrame = SlipProcessor::encodeSlip(packet);
+}
+
+bool IoWorker::post(quint32 session, QByteArrayView encoded)
+{
+    if (!m_outbound.push(session, SpscFrameRing::Frame, encoded)) {
+        if ((m_droppedOutbound++ & 1023) == 0)
+            qCWarning(lcIo) << "Outbound queue full, dropping frame for session" << session;
+        return false;
+    }
+    if (m_outbound.requestWake())
+        QMetaObject::invokeMethod(this, &IoWorker::drainOutbound, Qt::QueuedConnection);
+    return true;
+}
+
+void IoWorker::drainOutbound()
+{
+    m_outbound.clearWake();
+    m_outbound.drain([this](quint32 session, quint32 kind, QByteArrayView payload) {
+        if (kind == SpscFrameRing::Frame)
+            writeTo(session, payload);
+    });
+}
+
+void IoWorker::setSendQueue(QueuePolicy policy, qint64 limit)
+{
+    m_queuePolicy = policy;
+    m_queueLimit = qMax<qint64>(limit, 4096);
+}
+
+void IoWorker::writeTo(quint32 target, QByteArrayView encoded)
+{
+    if (target != AllSessions && target != AllSocketSessions && target != AllSerialSessions) {
+        auto it = m_sessions.find(target);
+        if (it != m_sessions.end())
+            writeToSession(target, it.value(), encoded);
+        return;
+    }
+
+    for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+        const bool serial = it->transport->kind() == Transport::Serial;
+        if ((target == AllSocketSessions && serial) || (target == AllSerialSessions && !serial))
+            continue;
+        writeToSession(it.key(), it.value(), encoded);
+    }
+}
+
+void IoWorker::writeToSession(quint32 id, Session &session, QByteArrayView encoded)
+{
+    if (session.closing || !session.device || !session.device->isOpen())
+        return;
+
+    if (session.backlog.empty() && session.device->bytesToWrite() < m_queueLimit) {
+        session.device->write(encoded.data(), encoded.size());
+        TransportCounters::add(session.counters->framesOut);
+        TransportCounters::add(session.counters->bytesOut, encoded.size());
+        return;
+    }
+
+    // The client is not keeping up
+    if (m_queuePolicy == Disconnect && session.transport->kind() != Transport::Serial) {
+        qCWarning(lcIo) << "Session" << id << "exceeded its send queue limit, disconnecting";
+        TransportCounters::add(session.counters->queueDisconnects);
+        session.closing = true;
+        // Queued: the socket must not close while m_sessions is iterated
+        QMetaObject::invokeMethod(session.transport,
+                                  [transport = session.transport, device = session.device]() {
+                                      transport->disconnectDevice(device);
+                                  }, Qt::QueuedConnection);
+        return;
+    }
+
+    session.backlog.emplace_back(encoded.data(), encoded.size());
+    session.backlogBytes += encoded.size();
+    while (session.backlogBytes > m_queueLimit && session.backlog.size() > 1) {
+        session.backlogBytes -= session.backlog.front().size();
+        session.backlog.pop_front();
+        ++session.droppedFrames;
+        TransportCounters::add(session.counters->queueDropped);
+    }
+    if (!session.congested) {
+        session.congested = true;
+        emit sessionCongestionChanged(id, true);
+    }
+}
+
+void IoWorker::flushBacklog(quint32 id, Session &session)
+{
+    while (!session.backlog.empty() && session.device->bytesToWrite() < m_queueLimit) {
+        const QByteArray &frame = session.backlog.front();
+        session.device->write(frame);
+        TransportCounters::add(session.counters->framesOut);
+        TransportCounters::add(session.counters->bytesOut, frame.size());
+        session.backlogBytes -= frame.size();
+        session.backlog.pop_front();
+    }
+
+    // Some hysteresis, so a client hovering at the limit does not flap
+    if (session.congested && session.backlog.empty()
+            && session.device->bytesToWrite() < m_queueLimit / 2) {
+        session.congested = false;
+        emit sessionCongestionChanged(id, false);
+    }
+}
+
+void IoWorker::handleBytesWritten()
+{
+    auto device = qobject_cast<QIODevice *>(sender());
+    const quint32 id = m_sessionIds.value(device);
+    auto it = m_sessions.find(id);
+    if (it != m_sessions.end() && !it->closing)
+        flushBacklog(id, it.value());
+}
+
+bool IoWorker::pushInbound(quint32 session, quint32 kind, QByteArrayView payload)
+{
+    if (!m_inbound.push(session, kind, payload)) {
+        if ((m_droppedInbound++ & 1023) == 0)
+            qCWarning(lcIo) << "Inbound queue full, dropping frame from session" << session;
+        return false;
+    }
+    if (m_inbound.requestWake())
+        emit inboundReady();
+    return true;
+}
+
+IoMetrics IoWorker::metrics() const
+{
+    IoMetrics metrics;
+    auto transport = [](const QString &name, const TransportCounters &counters) {
+        IoMetrics::Transport t;
+        t.name = name;
+        t.framesIn = counters.framesIn.load(std::memory_order_relaxed);
+        t.framesOut = counters.framesOut.load(std::memory_order_relaxed);
+        t.bytesIn = counters.bytesIn.load(std::memory_order_relaxed);
+        t.bytesOut = counters.bytesOut.load(std::memory_order_relaxed);
+        t.slipErrors = counters.slipErrors.load(std::memory_order_relaxed);
+        t.dropped = counters.dropped.load(std::memory_order_relaxed);
+        t.queueDropped = counters.queueDropped.load(std::memory_order_relaxed);
+        t.queueDisconnects = counters.queueDisconnects.load(std::memory_order_relaxed);
+        return t;
+    };
+    for (const Transport *t : m_transports)
+        metrics.transports << transport(t->name(), t->counters());
+
+    metrics.rings << IoMetrics::Ring{ QStringLiteral("inbound"), m_inbound.usedBytes(),
+                                      m_inbound.capacity(), m_droppedInbound.load() }
+                  << IoMetrics::Ring{ QStringLiteral("outbound"), m_outbound.usedBytes(),
+                                      m_outbound.capacity(), m_droppedOutbound.load() };
+
+    for (auto it = m_sessions.cbegin(); it != m_sessions.cend(); ++it) {
+        IoMetrics::Session session;
+        session.id = it.key();
+        session.transport = it->transport->name();
+        session.queuedBytes = it->device->bytesToWrite() + it->backlogBytes;
+        session.droppedFrames = it->droppedFrames;
+        session.congested = it->congested;
+        metrics.sessions << session;
+    }
+    return metrics;
+}
+
+quint32 IoWorker::openSession(QIODevice *device, Transport *transport)
+{
+    quint32 id = m_nextSession++;
+    if (m_nextSession >= AllSerialSessions)
+        m_nextSession = 1;
+
+    Session session;
+    session.device = device;
+    session.slipProcessor = new SlipProcessor(this);
+    session.transport = transport;
+    session.counters = &transport->counters();
+    m_sessions.insert(id, session);
+    m_sessionIds.insert(device, id);
+    connect(device, &QIODevice::readyRead, this, &IoWorker::handleReadyRead);
+    connect(device, &QIODevice::bytesWritten, this, &IoWorker::handleBytesWritten);
+
+    pushInbound(id, SpscFrameRing::SessionOpened);
+
+    if (transport->kind() == Transport::Serial) {
+        emit serialConnectionStateChanged(true);
+    } else {
+        const int clients = socketClientCount();
+        emit connectedClientsChanged(clients);
+        qDebug() << "New client connected on" << transport->name() << "Total clients:" << clients;
+    }
+    return id;
+}
+
+void IoWorker::closeSession(quint32 id)
+{
+    const Session session = m_sessions.take(id);
+    if (!session.device)
+        return;
+
+    disconnect(session.device, nullptr, this, nullptr);
+    m_sessionIds.remove(session.device);
+    session.slipProcessor->deleteLater();
+    pushInbound(id, SpscFrameRing::SessionClosed);
+}
+
+void IoWorker::handleDeviceClosed(QIODevice *device)
+{
+    const auto it = m_sessions.constFind(m_sessionIds.value(device));
+    if (it == m_sessions.constEnd())
+        return;
+    const Transport::Kind kind = it->transport->kind();
+    closeSession(it.key());
+
+    if (kind == Transport::Serial) {
+        emit serialConnectionStateChanged(sessionCount(Transport::Serial) > 0);
+        emit connectionLost("serial");
+        return;
+    }
+    emit connectedClientsChanged(socketClientCount());
+    if (sessionCount(kind) == 0)
+        emit connectionLost(kind == Transport::Tcp ? "tcp" : "local");
+}
+
+void IoWorker::readFrames(quint32 id)
+{
+    const auto it = m_sessions.constFind(id);
+    if (it == m_sessions.constEnd())
+        return;
+    const Session &session = it.value();
+
+    // Reuse one receive buffer so steady-state reads do not allocate
+    const qint64 available = session.device->bytesAvailable();
+    if (available <= 0) return;
+    m_readBuffer.resize(available);
+    const qint64 n = session.device->read(m_readBuffer.data(), available);
+    if (n <= 0) return;
+
+    TransportCounters &counters = *session.counters;
+    TransportCounters::add(counters.bytesIn, n);
+    const quint64 slipErrors = session.slipProcessor->invalidEscapeCount();
+    session.slipProcessor->decode(QByteArrayView(m_readBuffer.constData(), n), [this, id, &counters](QByteArrayView frame) {
+        TransportCounters::add(counters.framesIn);
+        if (!pushInbound(id, SpscFrameRing::Frame, frame))
+            TransportCounters::add(counters.dropped);
+    });
+    if (const quint64 errors = session.slipProcessor->invalidEscapeCount() - slipErrors)
+        TransportCounters::add(counters.slipErrors, errors);
+}
+
+bool IoWorker::addTransport(Transport *transport)
+{
+    for (Transport *existing : std::as_const(m_transports)) {
+        if (existing->name() == transport->name()) {
+            delete transport;
+            return existing->open();
+        }
+    }
+
+    transport->setParent(this);
+    connect(transport, &Transport::deviceOpened, this, [this, transport](QIODevice *device) {
+        openSession(device, transport);
+    });
+    connect(transport, &Transport::deviceClosed, this, &IoWorker::handleDeviceClosed);
+    connect(transport, &Transport::errorOccurred, this, &IoWorker::errorOccurred);
+    m_transports.append(transport);
+
+    // Also runs the periodic checks that reopen a port that failed here
+    startHeartbeat();
+    return transport->open();
+}
+
+bool IoWorker::addSerial(const QString &portName, int baudRate)
+{
+    const bool opened = addTransport(new SerialTransport(portName, baudRate));
+    if (!opened)
+        emit serialConnectionStateChanged(sessionCount(Transport::Serial) > 0);
+    return opened;
+}
+
+bool IoWorker::addTcp(int port)
+{
+    return addTransport(new TcpTransport(port));
+}
+
+bool IoWorker::addLocal(const QString &serverName)
+{
+    return addTransport(new LocalTransport(serverName));
+}
+
+void IoWorker::closeSerial()
+{
+    for (Transport *transport : std::as_const(m_transports)) {
+        if (transport->kind() == Transport::Serial)
+            transport->close();
+    }
+}
+
+void IoWorker::handleReadyRead()
+{
+    const quint32 id = m_sessionIds.value(qobject_cast<QIODevice *>(sender()));
+    if (!id) {
+        qDebug() << "Error: No session found for device";
+        return;
+    }
+    readFrames(id);
+}
+
+int IoWorker::sessionCount(Transport::Kind kind) const
+{
+    int count = 0;
+    for (const Session &session : m_sessions)
+        count += session.transport->kind() == kind;
+    return count;
+}
+
+int IoWorker::socketClientCount() const
+{
+    return sessionCount(Transport::Tcp) + sessionCount(Transport::Local);
+}
+
+void IoWorker::checkConnections()
+{
+    for (Transport *transport : std::as_const(m_transports))
+        transport->check();
+
+    if (!m_heartbeatFrame.isEmpty())
+        writeTo(AllSocketSessions, m_heartbeatFrame);
+
+    emit connectedClientsChanged(socketClientCount());
+}
+
+void IoWorker::startHeartbeat()
+{
+    if (!m_heartbeatTimer->isActive()) {
+        m_heartbeatTimer->start();
+    }
+}
+
+void IoWorker::stopHeartbeat()
+{
+    m_heartbeatTimer->stop();
+}
+
+void IoWorker::reconnectSerial()
+{
+    for (Transport *transport : std::as_const(m_transports)) {
+        if (transport->kind() != Transport::Serial)
+            continue;
+        transport->close();
+        transport->open();
+    }
+}
+
+void IoWorker::reconnectTCP()
+{
+    for (Transport *transport : std::as_const(m_transports)) {
+        if (transport->kind() == Transport::Tcp)
+            transport->open();
+    }
+}
+
+void IoWorker::shutdown()
+{
+    stopHeartbeat();
+
+    // Close the sessions first, so closing the devices below does not
+    // report every one of them as a lost connection
+    const QList<quint32> ids = m_sessions.keys();
+    for (quint32 id : ids)
+        closeSession(id);
+
+    for (Transport *transport : std::as_const(m_transports)) {
+        transport->close();
+        delete transport;
+    }
+    m_transports.clear();
+}
@@ -0,0 +1,122 @@
+#ifndef IOWORKER_H
+#define IOWORKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+
+#include <atomic>
+#include <deque>
+
+#include "metrics.h"
+#include "slipprocessor.h"
+#include "spscring.h"
+#include "transport.h"
+
+// Owns the transports (serial ports, TCP and local listeners) and one SLIP
+// decoder per connected device. Lives on its own thread: decoded frames are
+// pushed to the GUI thread through inbound(), and encoded frames come back
+// through post().
+class IoWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Targets for post() besides a single session
+    static constexpr quint32 AllSessions       = 0;
+    static constexpr quint32 AllSerialSessions = 0xFFFFFFFE;
+    static constexpr quint32 AllSocketSessions = 0xFFFFFFFF; // TCP and local
+
+    // What to do with a client that has sendQueueLimit() bytes waiting
+    enum QueuePolicy {
+        DropOldest,     // queue further frames, dropping the oldest past the limit
+        CollapseLatest, // like DropOldest, and ask the bridge to hold back changes
+        Disconnect      // drop the client (serial ports fall back to DropOldest)
+    };
+    Q_ENUM(QueuePolicy)
+
+    explicit IoWorker(QObject *parent = nullptr);
+    ~IoWorker();
+
+    // Call before the worker is moved to its thread
+    void setHeartbeatPacket(const QByteArray &packet);
+
+    // Thread-safe. Decoded frames and session events, for the GUI thread.
+    SpscFrameRing &inbound() { return m_inbound; }
+    // GUI thread only. Queues an already SLIP-encoded frame for a session.
+    bool post(quint32 session, QByteArrayView encoded);
+    // Must run on the worker thread
+    IoMetrics metrics() const;
+    void setSendQueue(QueuePolicy policy, qint64 limit);
+
+public slots:
+    // Must run on the worker thread. Each call adds one more endpoint;
+    // adding one that already exists only retries opening it.
+    bool addSerial(const QString &portName, int baudRate);
+    bool addTcp(int port);
+    bool addLocal(const QString &serverName);
+    void closeSerial();
+    void reconnectSerial();
+    void reconnectTCP();
+    void shutdown();
+    void drainOutbound();
+
+signals:
+    void inboundReady();
+    // A session's send queue crossed its limit, or drained back below half
+    void sessionCongestionChanged(quint32 session, bool congested);
+    void serialConnectionStateChanged(bool connected);
+    void connectedClientsChanged(int count);
+    void errorOccurred(const QString &error);
+    void connectionLost(const QString &type);
+
+private slots:
+    void handleReadyRead();
+    void handleBytesWritten();
+    void checkConnections();
+
+private:
+    struct Session {
+        QIODevice *device = nullptr;
+        SlipProcessor *slipProcessor = nullptr;
+        Transport *transport = nullptr;
+        TransportCounters *counters = nullptr;
+        // Frames waiting while the device already holds the queue limit
+        std::deque<QByteArray> backlog;
+        qint64 backlogBytes = 0;
+        quint64 droppedFrames = 0;
+        bool congested = false;
+        bool closing = false;
+    };
+
+    bool addTransport(Transport *transport);
+    quint32 openSession(QIODevice *device, Transport *transport);
+    void closeSession(quint32 id);
+    void handleDeviceClosed(QIODevice *device);
+    void readFrames(quint32 id);
+    bool pushInbound(quint32 session, quint32 kind, QByteArrayView payload = {});
+    void writeTo(quint32 target, QByteArrayView encoded);
+    void writeToSession(quint32 id, Session &session, QByteArrayView encoded);
+    void flushBacklog(quint32 id, Session &session);
+    int sessionCount(Transport::Kind kind) const;
+    int socketClientCount() const;
+    void startHeartbeat();
+    void stopHeartbeat();
+
+    SpscFrameRing m_inbound;
+    SpscFrameRing m_outbound;
+    QList<Transport *> m_transports;
+    QTimer *m_heartbeatTimer;
+    QHash<quint32, Session> m_sessions;
+    QHash<QIODevice*, quint32> m_sessionIds;
+    quint32 m_nextSession;
+    QByteArray m_readBuffer;
+    QByteArray m_heartbeatFrame;
+    std::atomic<quint64> m_droppedInbound;
+    std::atomic<quint64> m_droppedOutbound;
+    QueuePolicy m_queuePolicy;
+    qint64 m_queueLimit;
+};
+
+#endif
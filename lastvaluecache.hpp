@@ -0,0 +1,54 @@
+#ifndef LASTVALUECACHE_HPP
+#define LASTVALUECACHE_HPP
+
+#include <QList>
+#include <QVariant>
+
+// Last known value of each property, indexed by property ID. Every stored
+// change takes the next number of one server-wide version counter, so a
+// client that remembers the version of its last read can ask for only the
+// entries that changed after it. The counter never goes back, also when
+// entries are dropped, so an entry that comes back is always newer.
+class LastValueCache {
+public:
+    struct Entry {
+        QVariant value;
+        quint64 version = 0;   // 0: not cached
+    };
+
+    // Stores value under a new version unless it equals the cached one
+    const Entry& store(quint16 id, const QVariant& value) {
+        if (m_entries.size() <= id)
+            m_entries.resize(id + 1);
+        Entry& entry = m_entries[id];
+        if (entry.version == 0 || entry.value != value) {
+            entry.value = value;
+            entry.version = ++m_version;
+        }
+        return entry;
+    }
+
+    const Entry* find(quint16 id) const {
+        if (id >= m_entries.size() || m_entries.at(id).version == 0)
+            return nullptr;
+        return &m_entries.at(id);
+    }
+
+    bool contains(quint16 id) const { return find(id) != nullptr; }
+
+    void remove(quint16 id) {
+        if (id < m_entries.size())
+            m_entries[id] = Entry();
+    }
+
+    void clear() { m_entries.clear(); }
+
+    // Version of the newest stored change
+    quint64 version() const { return m_version; }
+
+private:
+    QList<Entry> m_entries;
+    quint64 m_version = 0;
+};
+
+#endif // LASTVALUECACHE_HPP
@@ -0,0 +1,4 @@
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcBridge, "qml.remoteserver.bridge", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcIo, "qml.remoteserver.io", QtInfoMsg)
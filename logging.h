@@ -0,0 +1,11 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// Per-command and per-frame logging. Debug output is off by default; enable
+// it at runtime with QT_LOGGING_RULES="qml.remoteserver.*.debug=true".
+Q_DECLARE_LOGGING_CATEGORY(lcBridge)
+Q_DECLARE_LOGGING_CATEGORY(lcIo)
+
+#endif
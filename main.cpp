@@ -10,58 +10,95 @@ int main(int argc, char *argv[])
     QCommandLineParser parser;
     parser.addHelpOption();
     parser.addPositionalArgument("qml", "QML file to load");
-    parser.addOption({{"p", "port"}, "Serial port", "port", "/dev/ttyUSB0"});
-    parser.addOption({{"b", "baudrate"}, "Baud rate", "baudrate", "115200"});
-    parser.addOption({{"t", "tcp"}, "TCP port", "tcpport", "0"});
+    parser.addOption({{"p", "port"}, "Serial port (repeatable)", "port"});
+    parser.addOption({{"b", "baudrate"}, "Baud rate of every serial port", "baudrate", "115200"});
+    parser.addOption({{"t", "tcp"}, "TCP port to listen on (repeatable)", "tcpport"});
+    parser.addOption({{"l", "local"}, "Local socket name or path to listen on (repeatable)", "name"});
+    parser.addOption({"shm", "Shared-memory update ring for local producers (Linux)", "name"});
+    parser.addOption({{"f", "flush-interval"}, "Property change flush interval in ms (0 = once per frame)", "msec", "0"});
+    parser.addOption({"queue-limit", "Bytes a client may have waiting before the queue policy applies", "bytes", "1048576"});
+    parser.addOption({"queue-policy", "Slow client policy: drop-oldest, collapse or disconnect", "policy", "collapse"});
+    parser.addOption({{"m", "metrics"}, "Serve Prometheus metrics on a localhost TCP port or a local socket path", "endpoint"});
+    parser.addOption({"discovery-cache", "Cache the discovered properties and methods in this file", "file"});
+    parser.addOption({"discovery-sources", "Directory whose QML sources, subdirectories included, key the discovery cache", "dir"});
+    parser.addOption({"hot-reload", "Reload the QML when it changes on disk, keeping IDs, written values and watches"});
     parser.process(app);
 
     QStringList args = parser.positionalArguments();
     if (args.isEmpty()) {
-        qDebug() << "Usage: program file.qml (--port /dev/ttyUSB0 --baudrate 115200) | (--tcp port)";
+        qDebug() << "Usage: program file.qml [--port /dev/ttyUSB0 --baudrate 115200] [--tcp port] [--local name] [--shm name]";
         return 1;
     }
 
-    QString port = parser.value("port");
-    int baudRate = parser.value("baudrate").toInt();
-    int tcpPort = parser.value("tcp").toInt();
+    const QStringList serialPorts = parser.values("port");
+    const QStringList tcpPorts = parser.values("tcp");
+    const QStringList localNames = parser.values("local");
+    const int baudRate = parser.value("baudrate").toInt();
 
-    bool use_serial = parser.isSet("port");
-    bool use_tcp = parser.isSet("tcp");
-
-    if (use_serial && use_tcp) {
-        qDebug() << "Error: Cannot use serial port and TCP simultaneously";
-        qDebug() << "Use --port for serial connection OR --tcp for TCP connection";
+    if (serialPorts.isEmpty() && tcpPorts.isEmpty() && localNames.isEmpty() && !parser.isSet("shm")) {
+        qDebug() << "Error: Must specify a communication method";
+        qDebug() << "Use any combination of --port, --tcp, --local and --shm";
         return 1;
     }
 
-    if (!use_serial && !use_tcp) {
-        qDebug() << "Error: Must specify a communication method";
-        qDebug() << "Use --port for serial connection OR --tcp for TCP connection";
+    GenericQMLBridge bridge;
+    bridge.setFlushInterval(parser.value("flush-interval").toInt());
+
+    IoWorker::QueuePolicy queuePolicy = IoWorker::CollapseLatest;
+    const QString policyName = parser.value("queue-policy");
+    if (policyName == "drop-oldest") {
+        queuePolicy = IoWorker::DropOldest;
+    } else if (policyName == "disconnect") {
+        queuePolicy = IoWorker::Disconnect;
+    } else if (policyName != "collapse") {
+        qDebug() << "Error: unknown queue policy" << policyName;
         return 1;
     }
+    bridge.setSendQueue(queuePolicy, parser.value("queue-limit").toLongLong());
 
-    GenericQMLBridge bridge;
+    if (parser.isSet("metrics") && !bridge.startMetricsEndpoint(parser.value("metrics"))) {
+        qDebug() << "Error:" << bridge.getLastError();
+        return 1;
+    }
 
+    if (parser.isSet("discovery-cache"))
+        bridge.setDiscoveryCache(parser.value("discovery-cache"), parser.value("discovery-sources"));
+    if (parser.isSet("hot-reload"))
+        bridge.setHotReload(true);
     if (!bridge.loadQML(args.first())) {
         return 1;
     }
 
-    if (use_serial) {
+    for (const QString &port : serialPorts) {
         if (!bridge.setupSerial(port, baudRate)) {
-            qDebug() << "Error initializing serial port";
+            qDebug() << "Error initializing serial port" << port;
             return 1;
         }
-    } else {
-        if (!bridge.setupTCP(tcpPort)) {
-            qDebug() << "Error initializing TCP server";
+        qDebug() << "Serial:" << port;
+    }
+    for (const QString &tcpPort : tcpPorts) {
+        if (!bridge.setupTCP(tcpPort.toInt())) {
+            qDebug() << "Error initializing TCP server on port" << tcpPort;
             return 1;
         }
         qDebug() << "TCP server listening on port" << tcpPort;
     }
+    for (const QString &name : localNames) {
+        if (!bridge.setupLocal(name)) {
+            qDebug() << "Error initializing local server" << name;
+            return 1;
+        }
+        qDebug() << "Local server listening on" << name;
+    }
+    if (parser.isSet("shm")) {
+        if (!bridge.setupSharedMemory(parser.value("shm"))) {
+            qDebug() << "Error:" << bridge.getLastError();
+            return 1;
+        }
+        qDebug() << "Shared-memory ring:" << parser.value("shm");
+    }
 
     qDebug() << "Generic bridge started. QML:" << args.first();
-    if (!port.isEmpty()) qDebug() << "Serial:" << port;
-    if (tcpPort > 0) qDebug() << "TCP puerto:" << tcpPort;
 
     return app.exec();
 }
@@ -0,0 +1,167 @@
+#include "metrics.h"
+
+#include <QCborArray>
+
+BridgeMetrics::BridgeMetrics(QMetaEnum commandNames)
+    : m_commandNames(commandNames)
+{
+}
+
+QString BridgeMetrics::commandName(int command) const
+{
+    const char *name = m_commandNames.valueToKey(command);
+    return name ? QString::fromLatin1(name)
+                : QStringLiteral("0x%1").arg(command, 2, 16, QLatin1Char('0'));
+}
+
+QCborMap BridgeMetrics::toCbor(const IoMetrics &io) const
+{
+    QCborMap transports;
+    for (const IoMetrics::Transport &t : io.transports) {
+        QCborMap entry;
+        entry[QStringLiteral("frames_in")] = qint64(t.framesIn);
+        entry[QStringLiteral("frames_out")] = qint64(t.framesOut);
+        entry[QStringLiteral("bytes_in")] = qint64(t.bytesIn);
+        entry[QStringLiteral("bytes_out")] = qint64(t.bytesOut);
+        entry[QStringLiteral("slip_errors")] = qint64(t.slipErrors);
+        entry[QStringLiteral("dropped")] = qint64(t.dropped);
+        entry[QStringLiteral("queue_dropped")] = qint64(t.queueDropped);
+        entry[QStringLiteral("queue_disconnects")] = qint64(t.queueDisconnects);
+        transports[t.name] = entry;
+    }
+
+    QCborMap rings;
+    for (const IoMetrics::Ring &r : io.rings) {
+        QCborMap entry;
+        entry[QStringLiteral("used")] = qint64(r.usedBytes);
+        entry[QStringLiteral("capacity")] = qint64(r.capacity);
+        entry[QStringLiteral("dropped")] = qint64(r.dropped);
+        rings[r.name] = entry;
+    }
+
+    QCborArray sessions;
+    for (const IoMetrics::Session &s : io.sessions) {
+        QCborMap entry;
+        entry[QStringLiteral("id")] = qint64(s.id);
+        entry[QStringLiteral("transport")] = s.transport;
+        entry[QStringLiteral("queued_bytes")] = s.queuedBytes;
+        entry[QStringLiteral("dropped")] = qint64(s.droppedFrames);
+        entry[QStringLiteral("congested")] = s.congested;
+        sessions.append(entry);
+    }
+
+    // Per command: count, total time and cumulative bucket counts in us
+    QCborMap commands;
+    for (size_t code = 0; code < m_commands.size(); ++code) {
+        const MetricsHistogram &h = m_commands[code];
+        if (!h.count())
+            continue;
+        QCborArray buckets;
+        quint64 cumulative = 0;
+        for (size_t i = 0; i < MetricsHistogram::BucketBounds.size(); ++i) {
+            cumulative += h.bucket(i);
+            buckets.append(QCborArray{ double(MetricsHistogram::BucketBounds[i]) / 1000.0, qint64(cumulative) });
+        }
+        QCborMap entry;
+        entry[QStringLiteral("count")] = qint64(h.count());
+        entry[QStringLiteral("sum_us")] = double(h.sum()) / 1000.0;
+        entry[QStringLiteral("buckets")] = buckets;
+        commands[commandName(int(code))] = entry;
+    }
+
+    QCborMap result;
+    result[QStringLiteral("transports")] = transports;
+    result[QStringLiteral("rings")] = rings;
+    result[QStringLiteral("sessions")] = sessions;
+    result[QStringLiteral("commands")] = commands;
+    result[QStringLiteral("unknown_ids")] = qint64(m_unknownIds);
+    result[QStringLiteral("published_changes")] = qint64(m_publishedChanges);
+    result[QStringLiteral("coalesced_writes")] = qint64(m_coalescedWrites);
+    return result;
+}
+
+QByteArray BridgeMetrics::toPrometheus(const IoMetrics &io) const
+{
+    QByteArray out;
+    auto header = [&out](const char *name, const char *type, const char *help) {
+        out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+        out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+    };
+    auto sample = [&out](const char *name, const QString &labels, double value) {
+        out += name;
+        if (!labels.isEmpty()) {
+            out += '{'; out += labels.toUtf8(); out += '}';
+        }
+        out += ' '; out += QByteArray::number(value, 'g', 17); out += '\n';
+    };
+
+    struct TransportField {
+        const char *name;
+        const char *help;
+        quint64 IoMetrics::Transport::*field;
+    };
+    static const TransportField transportFields[] = {
+        { "qml_remoteserver_frames_in_total", "Frames decoded from a transport", &IoMetrics::Transport::framesIn },
+        { "qml_remoteserver_frames_out_total", "Frames written to a transport", &IoMetrics::Transport::framesOut },
+        { "qml_remoteserver_bytes_in_total", "Bytes read from a transport", &IoMetrics::Transport::bytesIn },
+        { "qml_remoteserver_bytes_out_total", "Bytes written to a transport", &IoMetrics::Transport::bytesOut },
+        { "qml_remoteserver_slip_errors_total", "Frames dropped for an invalid SLIP escape", &IoMetrics::Transport::slipErrors },
+        { "qml_remoteserver_dropped_frames_total", "Inbound frames dropped because the queue was full", &IoMetrics::Transport::dropped },
+        { "qml_remoteserver_send_queue_dropped_total", "Outbound frames dropped from a full client send queue", &IoMetrics::Transport::queueDropped },
+        { "qml_remoteserver_send_queue_disconnects_total", "Clients disconnected for exceeding the send queue limit", &IoMetrics::Transport::queueDisconnects },
+    };
+    for (const TransportField &f : transportFields) {
+        header(f.name, "counter", f.help);
+        for (const IoMetrics::Transport &t : io.transports)
+            sample(f.name, QStringLiteral("transport=\"%1\"").arg(t.name), double(t.*f.field));
+    }
+
+    header("qml_remoteserver_ring_used_bytes", "gauge", "Bytes queued between the I/O thread and the GUI thread");
+    for (const IoMetrics::Ring &r : io.rings)
+        sample("qml_remoteserver_ring_used_bytes", QStringLiteral("ring=\"%1\"").arg(r.name), double(r.usedBytes));
+    header("qml_remoteserver_ring_capacity_bytes", "gauge", "Capacity of the queues between threads");
+    for (const IoMetrics::Ring &r : io.rings)
+        sample("qml_remoteserver_ring_capacity_bytes", QStringLiteral("ring=\"%1\"").arg(r.name), double(r.capacity));
+    header("qml_remoteserver_ring_dropped_total", "counter", "Records dropped because a queue between threads was full");
+    for (const IoMetrics::Ring &r : io.rings)
+        sample("qml_remoteserver_ring_dropped_total", QStringLiteral("ring=\"%1\"").arg(r.name), double(r.dropped));
+
+    header("qml_remoteserver_session_queued_bytes", "gauge", "Bytes waiting to be written to a client");
+    for (const IoMetrics::Session &s : io.sessions) {
+        sample("qml_remoteserver_session_queued_bytes",
+               QStringLiteral("session=\"%1\",transport=\"%2\"").arg(s.id).arg(s.transport),
+               double(s.queuedBytes));
+    }
+    header("qml_remoteserver_session_dropped_frames_total", "counter", "Frames dropped from a client's send queue");
+    for (const IoMetrics::Session &s : io.sessions) {
+        sample("qml_remoteserver_session_dropped_frames_total",
+               QStringLiteral("session=\"%1\",transport=\"%2\"").arg(s.id).arg(s.transport),
+               double(s.droppedFrames));
+    }
+
+    header("qml_remoteserver_command_duration_seconds", "histogram", "Time from command dispatch to completion");
+    for (size_t code = 0; code < m_commands.size(); ++code) {
+        const MetricsHistogram &h = m_commands[code];
+        if (!h.count())
+            continue;
+        const QString command = QStringLiteral("command=\"%1\"").arg(commandName(int(code)));
+        quint64 cumulative = 0;
+        for (size_t i = 0; i < MetricsHistogram::BucketBounds.size(); ++i) {
+            cumulative += h.bucket(i);
+            sample("qml_remoteserver_command_duration_seconds_bucket",
+                   command + QStringLiteral(",le=\"%1\"").arg(double(MetricsHistogram::BucketBounds[i]) / 1e9),
+                   double(cumulative));
+        }
+        sample("qml_remoteserver_command_duration_seconds_bucket", command + QStringLiteral(",le=\"+Inf\""), double(h.count()));
+        sample("qml_remoteserver_command_duration_seconds_sum", command, double(h.sum()) / 1e9);
+        sample("qml_remoteserver_command_duration_seconds_count", command, double(h.count()));
+    }
+
+    header("qml_remoteserver_unknown_ids_total", "counter", "Commands naming a property or method that does not exist");
+    sample("qml_remoteserver_unknown_ids_total", QString(), double(m_unknownIds));
+    header("qml_remoteserver_published_changes_total", "counter", "Property changes handed to watching clients");
+    sample("qml_remoteserver_published_changes_total", QString(), double(m_publishedChanges));
+    header("qml_remoteserver_coalesced_writes_total", "counter", "Inbound property writes superseded by a later one in the same frame");
+    sample("qml_remoteserver_coalesced_writes_total", QString(), double(m_coalescedWrites));
+    return out;
+}
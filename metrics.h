@@ -0,0 +1,119 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QCborMap>
+#include <QList>
+#include <QMetaEnum>
+#include <QString>
+
+#include <array>
+#include <atomic>
+
+// Latency histogram with fixed, Prometheus-style buckets (1 us .. 100 ms)
+class MetricsHistogram
+{
+public:
+    static constexpr std::array<qint64, 16> BucketBounds = {
+        1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+        1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000
+    };
+
+    void observe(qint64 ns)
+    {
+        size_t i = 0;
+        while (i < BucketBounds.size() && ns > BucketBounds[i])
+            ++i;
+        ++m_buckets[i];
+        ++m_count;
+        m_sum += ns;
+    }
+
+    quint64 count() const { return m_count; }
+    qint64 sum() const { return m_sum; }
+    // Count of observations in bucket i; the last one is +Inf
+    quint64 bucket(size_t i) const { return m_buckets[i]; }
+
+private:
+    std::array<quint64, BucketBounds.size() + 1> m_buckets {};
+    quint64 m_count = 0;
+    qint64 m_sum = 0;
+};
+
+// Per-transport counters. Written by the I/O worker, read by anyone.
+struct TransportCounters
+{
+    std::atomic<quint64> framesIn{0};
+    std::atomic<quint64> framesOut{0};
+    std::atomic<quint64> bytesIn{0};
+    std::atomic<quint64> bytesOut{0};
+    std::atomic<quint64> slipErrors{0};
+    std::atomic<quint64> dropped{0};
+    std::atomic<quint64> queueDropped{0};
+    std::atomic<quint64> queueDisconnects{0};
+
+    static void add(std::atomic<quint64> &counter, quint64 n = 1)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+};
+
+// Point-in-time copy of the I/O worker's state, taken on its thread
+struct IoMetrics
+{
+    struct Transport {
+        QString name;
+        quint64 framesIn = 0;
+        quint64 framesOut = 0;
+        quint64 bytesIn = 0;
+        quint64 bytesOut = 0;
+        quint64 slipErrors = 0;
+        quint64 dropped = 0;
+        quint64 queueDropped = 0;
+        quint64 queueDisconnects = 0;
+    };
+    struct Ring {
+        QString name;
+        quint64 usedBytes = 0;
+        quint64 capacity = 0;
+        quint64 dropped = 0;
+    };
+    struct Session {
+        quint32 id = 0;
+        QString transport;
+        qint64 queuedBytes = 0;
+        quint64 droppedFrames = 0;
+        bool congested = false;
+    };
+
+    QList<Transport> transports;
+    QList<Ring> rings;
+    QList<Session> sessions;
+};
+
+// Counters and histograms kept by the bridge on the GUI thread, rendered
+// together with a worker snapshot as CBOR or Prometheus text
+class BridgeMetrics
+{
+public:
+    explicit BridgeMetrics(QMetaEnum commandNames);
+
+    void recordCommand(quint8 command, qint64 ns) { m_commands[command].observe(ns); }
+    void countUnknownId() { ++m_unknownIds; }
+    void countPublished(quint64 changes) { m_publishedChanges += changes; }
+    void countCoalesced() { ++m_coalescedWrites; }
+
+    QCborMap toCbor(const IoMetrics &io) const;
+    QByteArray toPrometheus(const IoMetrics &io) const;
+
+private:
+    QString commandName(int command) const;
+
+    QMetaEnum m_commandNames;
+    std::array<MetricsHistogram, 256> m_commands;
+    quint64 m_unknownIds = 0;
+    quint64 m_publishedChanges = 0;
+    quint64 m_coalescedWrites = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "metricsserver.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+MetricsServer::MetricsServer(Renderer render, QObject *parent)
+    : QObject(parent)
+    , m_render(std::move(render))
+{
+}
+
+bool MetricsServer::listen(const QString &endpoint)
+{
+    bool isPort = false;
+    const quint16 port = endpoint.toUShort(&isPort);
+    if (isPort) {
+        m_tcpServer = new QTcpServer(this);
+        connect(m_tcpServer, &QTcpServer::newConnection, this, &MetricsServer::handleHttpConnection);
+        if (!m_tcpServer->listen(QHostAddress::LocalHost, port)) {
+            m_errorString = m_tcpServer->errorString();
+            return false;
+        }
+        return true;
+    }
+
+    m_localServer = new QLocalServer(this);
+    connect(m_localServer, &QLocalServer::newConnection, this, &MetricsServer::handleLocalConnection);
+    QLocalServer::removeServer(endpoint);
+    if (!m_localServer->listen(endpoint)) {
+        m_errorString = m_localServer->errorString();
+        return false;
+    }
+    return true;
+}
+
+void MetricsServer::handleHttpConnection()
+{
+    while (QTcpSocket *socket = m_tcpServer->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        // Any request gets the metrics once its headers are in
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n"))
+                return;
+            socket->readAll();
+            const QByteArray body = m_render();
+            socket->write("HTTP/1.0 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n");
+            socket->write(body);
+            socket->disconnectFromHost();
+        });
+    }
+}
+
+void MetricsServer::handleLocalConnection()
+{
+    while (QLocalSocket *socket = m_localServer->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        socket->write(m_render());
+        socket->disconnectFromServer();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <functional>
+
+class QLocalServer;
+class QTcpServer;
+
+// Serves the Prometheus text exposition produced by a render callback.
+// A numeric endpoint is a TCP port on localhost answering plain HTTP
+// scrapes; anything else names a local (Unix domain) socket that gets the
+// text and is closed, e.g. for `socat - UNIX-CONNECT:<path>`.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Renderer = std::function<QByteArray()>;
+
+    explicit MetricsServer(Renderer render, QObject *parent = nullptr);
+
+    bool listen(const QString &endpoint);
+    QString errorString() const { return m_errorString; }
+
+private:
+    void handleHttpConnection();
+    void handleLocalConnection();
+
+    Renderer m_render;
+    QTcpServer *m_tcpServer = nullptr;
+    QLocalServer *m_localServer = nullptr;
+    QString m_errorString;
+};
+
+#endif
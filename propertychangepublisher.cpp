@@ -0,0 +1,84 @@
+#include "propertychangepublisher.h"
+
+#include <QQuickWindow>
+#include <QTimer>
+
+PropertyChangePublisher::PropertyChangePublisher(QObject *parent)
+    : QObject(parent)
+    , m_flushTimer(new QTimer(this))
+{
+    m_flushTimer->setSingleShot(true);
+    connect(m_flushTimer, &QTimer::timeout, this, &PropertyChangePublisher::flush);
+}
+
+void PropertyChangePublisher::setFlushInterval(int msec)
+{
+    m_flushInterval = qMax(0, msec);
+}
+
+void PropertyChangePublisher::attachToWindow(QQuickWindow *window)
+{
+    QObject::disconnect(m_frameConnection);
+    m_window = window;
+    if (window) {
+        // frameSwapped comes from the render thread; it is queued to us
+        m_frameConnection = connect(window, &QQuickWindow::frameSwapped,
+                                    this, &PropertyChangePublisher::flush);
+    }
+}
+
+void PropertyChangePublisher::markDirty(quint16 id, const QVariant &value)
+{
+    auto it = m_changeIndex.constFind(id);
+    if (it != m_changeIndex.constEnd()) {
+        m_changes[it.value()].value = value;
+        return;
+    }
+
+    m_changeIndex.insert(id, m_changes.size());
+    m_changes.append({id, value});
+    scheduleFlush();
+}
+
+void PropertyChangePublisher::clear()
+{
+    m_flushTimer->stop();
+    m_flushScheduled = false;
+    m_changes.clear();
+    m_changeIndex.clear();
+}
+
+void PropertyChangePublisher::scheduleFlush()
+{
+    if (m_flushScheduled) return;
+    m_flushScheduled = true;
+
+    if (m_flushInterval == 0 && m_window && m_window->isExposed()) {
+        // Ask for a frame; the batch goes out when it is swapped. Safety
+        // net in case the frame never comes, e.g. an idle or blocked
+        // render loop.
+        m_window->update();
+        m_flushTimer->start(FrameFallbackMs);
+        return;
+    }
+    m_flushTimer->start(m_flushInterval);
+}
+
+void PropertyChangePublisher::flush()
+{
+    m_flushTimer->stop();
+    m_flushScheduled = false;
+    if (m_changes.isEmpty()) return;
+
+    // Swap so changes raised from inside the sink start a new batch
+    QList<Change> batch;
+    batch.swap(m_changes);
+    m_changeIndex.clear();
+
+    if (m_sink)
+        m_sink(batch);
+
+    batch.clear();
+    if (m_changes.isEmpty())
+        m_changes.swap(batch);
+}
@@ -0,0 +1,58 @@
+#ifndef PROPERTYCHANGEPUBLISHER_H
+#define PROPERTYCHANGEPUBLISHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QVariant>
+#include <functional>
+
+class QQuickWindow;
+class QTimer;
+
+// Collects watched property changes and hands them out in batches, keeping
+// only the latest value per property ID. A batch is flushed every
+// flushInterval() milliseconds, or once per rendered frame of the attached
+// window when the interval is 0, or after FrameFallbackMs if no frame comes.
+class PropertyChangePublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Change {
+        quint16 id;
+        QVariant value;
+    };
+    using Sink = std::function<void(const QList<Change> &changes)>;
+
+    explicit PropertyChangePublisher(QObject *parent = nullptr);
+
+    void setSink(Sink sink) { m_sink = std::move(sink); }
+    void setFlushInterval(int msec);
+    int flushInterval() const { return m_flushInterval; }
+    void attachToWindow(QQuickWindow *window);
+
+    void markDirty(quint16 id, const QVariant &value);
+    void clear();
+    bool isEmpty() const { return m_changes.isEmpty(); }
+
+public slots:
+    void flush();
+
+private:
+    void scheduleFlush();
+
+    static constexpr int FrameFallbackMs = 50;
+
+    Sink m_sink;
+    QTimer *m_flushTimer;
+    QPointer<QQuickWindow> m_window;
+    QMetaObject::Connection m_frameConnection;
+    int m_flushInterval = 0;
+    bool m_flushScheduled = false;
+    QList<Change> m_changes;
+    QHash<quint16, qsizetype> m_changeIndex;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "shmtransport.h"
+
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <new>
+
+#include <sys/eventfd.h>
+
+ShmTransport::ShmTransport(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ShmTransport::~ShmTransport()
+{
+    close();
+}
+
+bool ShmTransport::open(const QString &name, quint32 capacity)
+{
+    close();
+
+    quint32 records = 64;
+    while (records < capacity)
+        records <<= 1;
+
+    m_name = QLatin1Char('/') + name;
+    const QByteArray shmName = m_name.toLocal8Bit();
+    // A previous instance that crashed leaves its segment behind
+    shm_unlink(shmName.constData());
+    const int fd = shm_open(shmName.constData(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        m_errorString = tr("shm_open %1: %2").arg(m_name, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    const size_t size = ShmUpdateRingHeader::segmentSize(records);
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int mapErrno = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        m_errorString = tr("Mapping %1: %2").arg(m_name, QString::fromLocal8Bit(strerror(mapErrno)));
+        shm_unlink(shmName.constData());
+        return false;
+    }
+    m_header = new (map) ShmUpdateRingHeader{};
+    m_mapSize = size;
+    m_records = m_header->records();
+    m_mask = records - 1;
+
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd < 0) {
+        m_errorString = tr("eventfd: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        close();
+        return false;
+    }
+    m_wakeNotifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
+    connect(m_wakeNotifier, &QSocketNotifier::activated, this, &ShmTransport::handleWake);
+
+    m_server = new QLocalServer(this);
+    connect(m_server, &QLocalServer::newConnection, this, &ShmTransport::handleNewConnection);
+    // Not the shm name itself: a --local endpoint may use that one, and
+    // clearing a stale socket must not take it away
+    const QString wakeName = name + QStringLiteral(".wake");
+    QLocalServer::removeServer(wakeName);
+    if (!m_server->listen(wakeName)) {
+        m_errorString = tr("Listening on %1: %2").arg(wakeName, m_server->errorString());
+        close();
+        return false;
+    }
+    const QByteArray serverPath = m_server->fullServerName().toLocal8Bit();
+    if (size_t(serverPath.size()) >= sizeof(m_header->wakeSocket)) {
+        m_errorString = tr("Socket path too long: %1").arg(m_server->fullServerName());
+        close();
+        return false;
+    }
+    std::memcpy(m_header->wakeSocket, serverPath.constData(), serverPath.size());
+
+    m_header->capacity = records;
+    m_header->recordSize = sizeof(ShmUpdateRecord);
+    m_header->version = ShmUpdateRingHeader::Version;
+    // Written last: a producer checks it before anything else
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = ShmUpdateRingHeader::Magic;
+    return true;
+}
+
+void ShmTransport::close()
+{
+    delete m_server;
+    m_server = nullptr;
+    delete m_wakeNotifier;
+    m_wakeNotifier = nullptr;
+    if (m_eventFd >= 0)
+        ::close(m_eventFd);
+    m_eventFd = -1;
+    if (m_header) {
+        munmap(m_header, m_mapSize);
+        shm_unlink(m_name.toLocal8Bit().constData());
+    }
+    m_header = nullptr;
+    m_records = nullptr;
+}
+
+void ShmTransport::handleWake()
+{
+    quint64 count;
+    while (::read(m_eventFd, &count, sizeof(count)) == sizeof(count)) {
+    }
+    emit updatesReady();
+}
+
+void ShmTransport::handleNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        // Pass the eventfd along with a single byte, then hang up
+        char byte = 0;
+        iovec iov = { &byte, 1 };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &m_eventFd, sizeof(int));
+        if (sendmsg(int(socket->socketDescriptor()), &msg, MSG_NOSIGNAL) < 0)
+            qWarning() << "Failed to hand the wake-up eventfd to a producer:" << strerror(errno);
+
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        socket->disconnectFromServer();
+    }
+}
+
+quint64 ShmTransport::usedBytes() const
+{
+    if (!m_header)
+        return 0;
+    return (m_header->tail.load(std::memory_order_acquire) - m_header->head.load(std::memory_order_acquire))
+            * sizeof(ShmUpdateRecord);
+}
+
+quint64 ShmTransport::capacityBytes() const
+{
+    return m_header ? quint64(m_mask + 1) * sizeof(ShmUpdateRecord) : 0;
+}
+
+quint64 ShmTransport::dropped() const
+{
+    return m_header ? m_header->dropped.load(std::memory_order_relaxed) : 0;
+}
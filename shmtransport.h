@@ -0,0 +1,77 @@
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include <QObject>
+#include <QString>
+
+#include "shmupdatering.hpp"
+
+class QLocalServer;
+class QSocketNotifier;
+
+// Server side of the shared-memory update ring (see shmupdatering.hpp).
+// Lives on the GUI thread: the bridge calls drain() once per frame and
+// applies the records directly, without going through the I/O worker.
+class ShmTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ShmTransport(QObject *parent = nullptr);
+    ~ShmTransport();
+
+    // Creates /<name> with room for capacity records (rounded up to a power
+    // of two) and listens for producers on the local socket <name>.wake
+    bool open(const QString &name, quint32 capacity);
+    QString errorString() const { return m_errorString; }
+
+    // Calls onRecord(const ShmUpdateRecord &) for every queued record
+    template <typename RecordHandler>
+    qsizetype drain(RecordHandler &&onRecord)
+    {
+        if (!m_header)
+            return 0;
+        // Clear before reading the tail, so a push racing with this drain
+        // either is seen here or signals the eventfd again
+        m_header->wakePending.store(0, std::memory_order_seq_cst);
+        quint64 head = m_header->head.load(std::memory_order_relaxed);
+        const quint64 tail = m_header->tail.load(std::memory_order_seq_cst);
+        // The tail comes from another process: never walk more than one
+        // ring's worth, and count what a bad tail claims beyond that
+        const quint64 capacity = m_mask + 1;
+        if (tail - head > capacity) {
+            m_header->dropped.fetch_add(tail - head - capacity, std::memory_order_relaxed);
+            head = tail - capacity;
+        }
+        const qsizetype count = qsizetype(tail - head);
+        for (; head != tail; ++head)
+            onRecord(m_records[head & m_mask]);
+        m_header->head.store(head, std::memory_order_release);
+        return count;
+    }
+
+    quint64 usedBytes() const;
+    quint64 capacityBytes() const;
+    quint64 dropped() const;
+
+signals:
+    // The producer pushed into an empty ring
+    void updatesReady();
+
+private:
+    void handleWake();
+    void handleNewConnection();
+    void close();
+
+    QString m_name;
+    QString m_errorString;
+    ShmUpdateRingHeader *m_header = nullptr;
+    ShmUpdateRecord *m_records = nullptr;
+    size_t m_mapSize = 0;
+    quint64 m_mask = 0;
+    int m_eventFd = -1;
+    QSocketNotifier *m_wakeNotifier = nullptr;
+    QLocalServer *m_server = nullptr;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef SHMUPDATERING_HPP
+#define SHMUPDATERING_HPP
+
+// Shared-memory property update ring (Linux only).
+//
+// A co-located producer, e.g. a control loop in another process, writes
+// fixed-size update records straight into a POSIX shared-memory SPSC ring
+// created by the server; the bridge drains it once per frame. There is no
+// framing, escaping or socket in the data path. The server hands out an
+// eventfd, used only to wake it when the ring goes from idle to non-empty.
+//
+// This header has no Qt dependency so producers can include it as is.
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+enum ShmUpdateType : uint8_t {
+    ShmUpdateBool   = 1, // value.i, non-zero is true
+    ShmUpdateInt    = 2, // value.i
+    ShmUpdateDouble = 3  // value.d
+};
+
+// One property update, in host byte order. id is the property ID from
+// RESP_GET_PROPERTY_LIST.
+struct ShmUpdateRecord {
+    uint16_t id;
+    uint8_t type;
+    uint8_t reserved[5];
+    union {
+        int64_t i;
+        double d;
+    } value;
+};
+static_assert(sizeof(ShmUpdateRecord) == 16, "ShmUpdateRecord must stay 16 bytes");
+
+struct ShmUpdateRingHeader {
+    static constexpr uint32_t Magic = 0x51524D55; // "QRMU"
+    static constexpr uint32_t Version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;   // records, a power of two
+    uint32_t recordSize;
+    // Unix socket that hands the eventfd to a connecting producer
+    char wakeSocket[108];
+
+    alignas(64) std::atomic<uint64_t> head; // written by the server
+    alignas(64) std::atomic<uint64_t> tail; // written by the producer
+    // Set by the producer when it signals the eventfd, cleared by the
+    // server before it drains, so a burst costs one write()
+    alignas(64) std::atomic<uint32_t> wakePending;
+    // Records the producer could not push because the ring was full
+    std::atomic<uint64_t> dropped;
+
+    static size_t recordsOffset()
+    {
+        return (sizeof(ShmUpdateRingHeader) + 63) & ~size_t(63);
+    }
+    static size_t segmentSize(uint32_t capacity)
+    {
+        return recordsOffset() + size_t(capacity) * sizeof(ShmUpdateRecord);
+    }
+    ShmUpdateRecord *records()
+    {
+        return reinterpret_cast<ShmUpdateRecord *>(reinterpret_cast<char *>(this) + recordsOffset());
+    }
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the shared ring needs lock-free 64-bit atomics");
+
+// Producer side. Not thread-safe: one producer thread per ring.
+class ShmUpdateProducer
+{
+public:
+    ShmUpdateProducer() = default;
+    ShmUpdateProducer(const ShmUpdateProducer &) = delete;
+    ShmUpdateProducer &operator=(const ShmUpdateProducer &) = delete;
+    ~ShmUpdateProducer() { close(); }
+
+    // name as given to the server's --shm option
+    bool open(const char *name)
+    {
+        char shmName[NAME_MAX];
+        if (snprintf(shmName, sizeof(shmName), "/%s", name) >= int(sizeof(shmName)))
+            return false;
+        const int fd = shm_open(shmName, O_RDWR, 0);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(ShmUpdateRingHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void *map = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+        m_header = static_cast<ShmUpdateRingHeader *>(map);
+        m_mapSize = size_t(st.st_size);
+
+        if (m_header->magic != ShmUpdateRingHeader::Magic
+                || m_header->version != ShmUpdateRingHeader::Version
+                || m_header->recordSize != sizeof(ShmUpdateRecord)
+                || ShmUpdateRingHeader::segmentSize(m_header->capacity) > m_mapSize
+                || !receiveEventFd()) {
+            close();
+            return false;
+        }
+        m_records = m_header->records();
+        m_mask = m_header->capacity - 1;
+        return true;
+    }
+
+    void close()
+    {
+        if (m_eventFd >= 0)
+            ::close(m_eventFd);
+        if (m_header)
+            munmap(m_header, m_mapSize);
+        m_eventFd = -1;
+        m_header = nullptr;
+        m_records = nullptr;
+    }
+
+    // Returns false and counts a drop when the ring is full
+    bool push(const ShmUpdateRecord &record)
+    {
+        const uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+        if (tail - m_header->head.load(std::memory_order_acquire) > m_mask) {
+            m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_records[tail & m_mask] = record;
+        m_header->tail.store(tail + 1, std::memory_order_seq_cst);
+        if (!m_header->wakePending.exchange(1, std::memory_order_seq_cst)) {
+            const uint64_t one = 1;
+            (void)!::write(m_eventFd, &one, sizeof(one));
+        }
+        return true;
+    }
+
+    bool pushBool(uint16_t id, bool value) { return push(make(id, ShmUpdateBool, value ? 1 : 0)); }
+    bool pushInt(uint16_t id, int64_t value) { return push(make(id, ShmUpdateInt, value)); }
+    bool pushDouble(uint16_t id, double value)
+    {
+        ShmUpdateRecord record = make(id, ShmUpdateDouble, 0);
+        record.value.d = value;
+        return push(record);
+    }
+
+private:
+    static ShmUpdateRecord make(uint16_t id, uint8_t type, int64_t value)
+    {
+        ShmUpdateRecord record = {};
+        record.id = id;
+        record.type = type;
+        record.value.i = value;
+        return record;
+    }
+
+    bool receiveEventFd()
+    {
+        const int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock < 0)
+            return false;
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, m_header->wakeSocket, sizeof(addr.sun_path) - 1);
+        if (connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            ::close(sock);
+            return false;
+        }
+
+        char byte;
+        iovec iov = { &byte, 1 };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        const ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        ::close(sock);
+
+        cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            return false;
+        std::memcpy(&m_eventFd, CMSG_DATA(cmsg), sizeof(int));
+        return true;
+    }
+
+    ShmUpdateRingHeader *m_header = nullptr;
+    ShmUpdateRecord *m_records = nullptr;
+    size_t m_mapSize = 0;
+    uint64_t m_mask = 0;
+    int m_eventFd = -1;
+};
+
+#endif
@@ -1,56 +1,163 @@
 #include "slipprocessor.h"
 
 #include <QDebug>
+#include <QIODevice>
 
 SlipProcessor::SlipProcessor(QObject *parent)
     : QObject(parent)
 {
 }
 
-QByteArray SlipProcessor::encodeSlip(const QByteArray &input)
+QByteArray SlipProcessor::encodeSlip(QByteArrayView input)
 {
-    QByteArray encoded;
+    QByteArray encoded(encodedSize(input), Qt::Uninitialized);
+    encodeSlip(input, encoded.data());
+    return encoded;
+}
+
+qsizetype SlipProcessor::encodedSize(QByteArrayView input)
+{
+    if (input.isEmpty())
+        return 1;
+    qsizetype specials = 0;
+    for (char byte : input)
+        specials += ((uint8_t)byte == SLIP_END) | ((uint8_t)byte == SLIP_ESC);
+    return input.size() + specials + 1;
+}
+
+char *SlipProcessor::encodeSlip(QByteArrayView input, char *out)
+{
+    // An empty view may have a null data(), which memchr and memcpy must
+    // not see even with a zero length
+    if (input.isEmpty()) {
+        *out++ = char(SLIP_END);
+        return out;
+    }
+
+    const char *p = input.data();
+    const char *const end = p + input.size();
+    const char *nextEnd = static_cast<const char *>(std::memchr(p, SLIP_END, end - p));
+    const char *nextEsc = static_cast<const char *>(std::memchr(p, SLIP_ESC, end - p));
+
+    while (p < end) {
+        const char *special = end;
+        if (nextEnd && nextEnd < special) special = nextEnd;
+        if (nextEsc && nextEsc < special) special = nextEsc;
 
-    for (char byte : input) {
-        if ((uint8_t)byte == SLIP_END) {
-            encoded.append(SLIP_ESC);
-            encoded.append(SLIP_ESC_END);
-        } else if ((uint8_t)byte == SLIP_ESC) {
-            encoded.append(SLIP_ESC);
-            encoded.append(SLIP_ESC_ESC);
+        std::memcpy(out, p, special - p);
+        out += special - p;
+        if (special == end)
+            break;
+
+        *out++ = char(SLIP_ESC);
+        if (special == nextEnd) {
+            *out++ = char(SLIP_ESC_END);
+            nextEnd = static_cast<const char *>(std::memchr(special + 1, SLIP_END, end - special - 1));
         } else {
-            encoded.append(byte);
+            *out++ = char(SLIP_ESC_ESC);
+            nextEsc = static_cast<const char *>(std::memchr(special + 1, SLIP_ESC, end - special - 1));
         }
+        p = special + 1;
     }
 
-    encoded.append(SLIP_END);
-    return encoded;
+    *out++ = char(SLIP_END);
+    return out;
+}
+
+void SlipProcessor::appendSlip(QByteArrayView input, QByteArray &out)
+{
+    const qsizetype offset = out.size();
+    out.resize(offset + encodedSize(input));
+    encodeSlip(input, out.data() + offset);
+}
+
+qint64 SlipProcessor::writeSlip(QIODevice *device, QByteArrayView input)
+{
+    static const char escEnd[] = { char(SLIP_ESC), char(SLIP_ESC_END) };
+    static const char escEsc[] = { char(SLIP_ESC), char(SLIP_ESC_ESC) };
+    static const char frameEnd[] = { char(SLIP_END) };
+
+    if (input.isEmpty())
+        return device->write(frameEnd, 1) < 0 ? -1 : 1;
+
+    const char *p = input.data();
+    const char *const end = p + input.size();
+    qint64 written = 0;
+
+    auto put = [&](const char *data, qint64 len) {
+        if (len <= 0 || written < 0) return;
+        const qint64 n = device->write(data, len);
+        written = n < 0 ? -1 : written + n;
+    };
+
+    const char *nextEnd = static_cast<const char *>(std::memchr(p, SLIP_END, end - p));
+    const char *nextEsc = static_cast<const char *>(std::memchr(p, SLIP_ESC, end - p));
+
+    while (p < end) {
+        const char *special = end;
+        if (nextEnd && nextEnd < special) special = nextEnd;
+        if (nextEsc && nextEsc < special) special = nextEsc;
+
+        put(p, special - p);
+        if (special == end)
+            break;
+
+        if (special == nextEnd) {
+            put(escEnd, 2);
+            nextEnd = static_cast<const char *>(std::memchr(special + 1, SLIP_END, end - special - 1));
+        } else {
+            put(escEsc, 2);
+            nextEsc = static_cast<const char *>(std::memchr(special + 1, SLIP_ESC, end - special - 1));
+        }
+        p = special + 1;
+    }
+    put(frameEnd, 1);
+    return written;
 }
 
 void SlipProcessor::onDataReceived(const QByteArray &data)
 {
-    for (uint8_t byte : data) {
+    decode(data, [this](QByteArrayView frame) {
+        emit packetReceived(frame.toByteArray());
+    });
+}
+
+void SlipProcessor::reset()
+{
+    buffer.resize(0);
+    escapeNext = false;
+    discarding = false;
+}
+
+void SlipProcessor::appendUnescaped(const char *begin, const char *end)
+{
+    if (discarding)
+        return;
+    while (begin < end) {
         if (escapeNext) {
-            if (byte == SLIP_ESC_END)
-                buffer.append(SLIP_END);
-            else if (byte == SLIP_ESC_ESC)
-                buffer.append(SLIP_ESC);
-            else {
-                buffer.clear();
-            }
-            escapeNext = false;
-        } else {
-            if (byte == SLIP_END) {
-                if (!buffer.isEmpty()) {
-                    emit packetReceived(buffer);
-                    buffer.clear();
-                }
-            } else if (byte == SLIP_ESC) {
-                escapeNext = true;
+            const uint8_t byte = static_cast<uint8_t>(*begin++);
+            if (byte == SLIP_ESC_END) {
+                buffer.append(char(SLIP_END));
+            } else if (byte == SLIP_ESC_ESC) {
+                buffer.append(char(SLIP_ESC));
             } else {
-                buffer.append(byte);
+                // Drop the frame and everything up to its SLIP_END
+                buffer.resize(0);
+                ++invalidEscapes;
+                escapeNext = false;
+                discarding = true;
+                return;
             }
+            escapeNext = false;
+            continue;
         }
+
+        const char *esc = static_cast<const char *>(std::memchr(begin, SLIP_ESC, end - begin));
+        const char *runEnd = esc ? esc : end;
+        buffer.append(begin, runEnd - begin);
+        if (!esc)
+            break;
+        escapeNext = true;
+        begin = esc + 1;
     }
 }
-
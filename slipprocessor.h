@@ -3,6 +3,11 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QByteArrayView>
+
+#include <cstring>
+
+class QIODevice;
 
 class SlipProcessor : public QObject
 {
@@ -11,7 +16,31 @@ class SlipProcessor : public QObject
 public:
     explicit SlipProcessor(QObject *parent = nullptr);
 
-    static QByteArray encodeSlip(const QByteArray &data);
+    static QByteArray encodeSlip(QByteArrayView data);
+
+    // Size of the encoded frame, including the trailing SLIP_END
+    static qsizetype encodedSize(QByteArrayView data);
+    // Escapes data into out, which must hold encodedSize(data) bytes.
+    // Returns one past the last byte written.
+    static char *encodeSlip(QByteArrayView data, char *out);
+    // Appends the encoded frame to out, reusing its capacity
+    static void appendSlip(QByteArrayView data, QByteArray &out);
+    // Writes the encoded frame straight into the device's write buffer,
+    // one block per unescaped run, without an intermediate allocation
+    static qint64 writeSlip(QIODevice *device, QByteArrayView data);
+
+    // Decodes a chunk of the incoming stream and calls onFrame(QByteArrayView)
+    // for every complete frame. Frames that arrive whole and unescaped are
+    // views into data; escaped frames and frames split across chunks are
+    // unescaped into the internal buffer. A view is only valid during the call.
+    template <typename FrameHandler>
+    void decode(QByteArrayView data, FrameHandler &&onFrame);
+
+    void reset();
+    // Frames dropped because of an invalid escape sequence. The rest of
+    // such a frame, up to the next SLIP_END, is discarded with it, so each
+    // corrupt frame counts once.
+    quint64 invalidEscapeCount() const { return invalidEscapes; }
 
 signals:
     void packetReceived(QByteArray packet);
@@ -20,8 +49,13 @@ public slots:
     void onDataReceived(const QByteArray &data);
 
 private:
+    void appendUnescaped(const char *begin, const char *end);
+
     QByteArray buffer;
     bool escapeNext = false;
+    // Set after an invalid escape until the frame ends
+    bool discarding = false;
+    quint64 invalidEscapes = 0;
 
     static constexpr uint8_t SLIP_END     = 0xC0;
     static constexpr uint8_t SLIP_ESC     = 0xDB;
@@ -29,4 +63,38 @@ private:
     static constexpr uint8_t SLIP_ESC_ESC = 0xDD;
 };
 
+template <typename FrameHandler>
+void SlipProcessor::decode(QByteArrayView data, FrameHandler &&onFrame)
+{
+    const char *p = data.data();
+    const char *const end = p + data.size();
+
+    while (p < end) {
+        const char *frameEnd = static_cast<const char *>(std::memchr(p, SLIP_END, end - p));
+        const char *stop = frameEnd ? frameEnd : end;
+
+        if (frameEnd && buffer.isEmpty() && !escapeNext && !discarding
+                && !std::memchr(p, SLIP_ESC, stop - p)) {
+            if (stop > p)
+                onFrame(QByteArrayView(p, stop - p));
+        } else {
+            appendUnescaped(p, stop);
+            if (frameEnd) {
+                if (escapeNext) {
+                    // ESC followed by END: the frame is corrupt, drop it
+                    buffer.resize(0);
+                    ++invalidEscapes;
+                    escapeNext = false;
+                }
+                if (!buffer.isEmpty())
+                    onFrame(QByteArrayView(buffer));
+                buffer.resize(0);
+                discarding = false;
+            }
+        }
+
+        p = frameEnd ? frameEnd + 1 : end;
+    }
+}
+
 #endif
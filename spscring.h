@@ -0,0 +1,146 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <QByteArrayView>
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+// Lock-free single-producer/single-consumer ring of variable-length records.
+// Used to hand frames between the I/O worker and the GUI thread: one thread
+// only pushes, the other only drains. Each record carries a session ID and
+// a kind so control events stay ordered with the frames around them.
+class SpscFrameRing
+{
+public:
+    enum Kind : quint32 {
+        Frame,
+        SessionOpened,
+        SessionClosed,
+        Padding = 0xFFFFFFFF
+    };
+
+    // capacity is rounded up to a power of two
+    explicit SpscFrameRing(quint32 capacity)
+    {
+        m_capacity = 64;
+        while (m_capacity < capacity)
+            m_capacity <<= 1;
+        m_buffer.reset(new char[m_capacity]);
+    }
+
+    SpscFrameRing(const SpscFrameRing &) = delete;
+    SpscFrameRing &operator=(const SpscFrameRing &) = delete;
+
+    quint32 capacity() const { return m_capacity; }
+
+    // Producer side. Returns false when the record does not fit.
+    bool push(quint32 session, quint32 kind, QByteArrayView payload = {})
+    {
+        const quint64 recordSize = alignedSize(payload.size());
+        if (recordSize > m_capacity)
+            return false;
+
+        quint64 tail = m_tail.load(std::memory_order_relaxed);
+        const quint64 head = m_head.load(std::memory_order_acquire);
+        const quint64 offset = tail & (m_capacity - 1);
+        const quint64 toEnd = m_capacity - offset;
+        const quint64 needed = recordSize <= toEnd ? recordSize : toEnd + recordSize;
+        if (m_capacity - (tail - head) < needed)
+            return false;
+
+        if (recordSize > toEnd) {
+            // Not enough room before the end: skip to the start
+            writeHeader(offset, {0, Padding, 0, 0});
+            tail += toEnd;
+        }
+
+        const quint64 at = tail & (m_capacity - 1);
+        writeHeader(at, {session, kind, quint32(payload.size()), 0});
+        if (!payload.isEmpty())
+            std::memcpy(m_buffer.get() + at + sizeof(Header), payload.data(), payload.size());
+        m_tail.store(tail + recordSize, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Calls onRecord(session, kind, payload) for every
+    // record; payload is a view into the ring valid only during the call.
+    template <typename RecordHandler>
+    qsizetype drain(RecordHandler &&onRecord)
+    {
+        quint64 head = m_head.load(std::memory_order_relaxed);
+        const quint64 tail = m_tail.load(std::memory_order_acquire);
+        qsizetype count = 0;
+
+        while (head != tail) {
+            const quint64 offset = head & (m_capacity - 1);
+            Header header;
+            std::memcpy(&header, m_buffer.get() + offset, sizeof(Header));
+            if (header.kind == Padding) {
+                head += m_capacity - offset;
+            } else {
+                onRecord(header.session, header.kind,
+                         QByteArrayView(m_buffer.get() + offset + sizeof(Header), header.length));
+                head += alignedSize(header.length);
+                ++count;
+            }
+            m_head.store(head, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // Bytes currently queued, record headers and padding included
+    quint64 usedBytes() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    // Wake-up coalescing: the producer calls requestWake() after pushing and
+    // only notifies the consumer when it returns true; the consumer calls
+    // clearWake() before draining. The fences keep the tail store before the
+    // flag check and the flag clear before the tail load: either the drain
+    // sees the record, or the producer sees the cleared flag and wakes.
+    bool requestWake()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return !m_wakePending.exchange(true, std::memory_order_acq_rel);
+    }
+    void clearWake()
+    {
+        m_wakePending.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+private:
+    struct Header {
+        quint32 session;
+        quint32 kind;
+        quint32 length;
+        quint32 reserved;
+    };
+
+    static quint64 alignedSize(qsizetype payloadSize)
+    {
+        return (sizeof(Header) + quint64(payloadSize) + 15) & ~quint64(15);
+    }
+
+    void writeHeader(quint64 offset, const Header &header)
+    {
+        std::memcpy(m_buffer.get() + offset, &header, sizeof(Header));
+    }
+
+    std::unique_ptr<char[]> m_buffer;
+    quint32 m_capacity;
+    alignas(64) std::atomic<quint64> m_head{0};
+    alignas(64) std::atomic<quint64> m_tail{0};
+    alignas(64) std::atomic<bool> m_wakePending{false};
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef BRIDGEHARNESS_H
+#define BRIDGEHARNESS_H
+
+#include <QCborMap>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QFile>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <memory>
+
+#include "genericqmlbridge.h"
+#include "slipprocessor.h"
+
+// A client on the bridge's local socket that speaks the wire protocol the
+// way a device does: SLIP frames out, decoded frames collected in order
+class TestClient
+{
+public:
+    TestClient()
+    {
+        QObject::connect(&m_socket, &QLocalSocket::readyRead, &m_socket, [this] {
+            if (!m_paused)
+                readAvailable();
+        });
+    }
+
+    bool connectTo(const QString &serverName)
+    {
+        m_socket.connectToServer(serverName);
+        return m_socket.waitForConnected(2000);
+    }
+
+    void send(quint8 command, const QCborValue &payload = QCborValue())
+    {
+        QByteArray packet(1, char(command));
+        if (!payload.isUndefined())
+            packet += payload.toCbor();
+        sendPacket(packet);
+    }
+
+    void sendPacket(const QByteArray &packet)
+    {
+        m_socket.write(SlipProcessor::encodeSlip(packet));
+        m_socket.flush();
+    }
+
+    // Round trip through SET_OPTIONS: once RESP_OPTIONS is back, the server
+    // has handled everything sent before. Returns the options in effect.
+    QCborMap sync(const QCborMap &options = QCborMap())
+    {
+        send(GenericQMLBridge::CMD_SET_OPTIONS, options);
+        return QCborValue::fromCbor(next(GenericQMLBridge::RESP_OPTIONS)).toMap();
+    }
+
+    // Waits for the next frame with the given response code and returns its
+    // payload; frames before it are discarded. Null on timeout.
+    QByteArray next(quint8 response, int timeoutMs = 2000)
+    {
+        QByteArray payload;
+        QTest::qWaitFor([&] {
+            while (!m_frames.isEmpty()) {
+                const QByteArray frame = m_frames.takeFirst();
+                if (quint8(frame.front()) == response) {
+                    payload = frame.mid(1);
+                    return true;
+                }
+            }
+            return false;
+        }, timeoutMs);
+        return payload;
+    }
+
+    // The next RESP_PROPERTY_CHANGE as an {id: value} map, empty on timeout
+    QCborMap nextChange(int timeoutMs = 2000)
+    {
+        return QCborValue::fromCbor(next(GenericQMLBridge::RESP_PROPERTY_CHANGE, timeoutMs)).toMap();
+    }
+
+    // Lets the server run for ms and reports whether any frame with the
+    // given response code came in
+    bool receives(quint8 response, int ms)
+    {
+        QTest::qWait(ms);
+        for (const QByteArray &frame : std::as_const(m_frames)) {
+            if (quint8(frame.front()) == response)
+                return true;
+        }
+        return false;
+    }
+
+    void clear() { m_frames.clear(); }
+
+    // Stops reading, so what the server writes backs up the way it does for
+    // a client that cannot keep up
+    void pause()
+    {
+        m_paused = true;
+        m_socket.setReadBufferSize(1);
+    }
+
+    void resume()
+    {
+        m_paused = false;
+        m_socket.setReadBufferSize(0);
+        readAvailable();
+    }
+
+private:
+    void readAvailable()
+    {
+        m_slip.decode(m_socket.readAll(), [this](QByteArrayView frame) {
+            m_frames.append(frame.toByteArray());
+        });
+    }
+
+    QLocalSocket m_socket;
+    SlipProcessor m_slip;
+    QList<QByteArray> m_frames;
+    bool m_paused = false;
+};
+
+// A bridge serving a QML scene written to a temporary directory, on a local
+// socket only this test process uses
+class BridgeHarness
+{
+public:
+    explicit BridgeHarness(const QByteArray &qml)
+    {
+        static int instance = 0;
+        m_serverName = QStringLiteral("qml-remoteserver-test-%1-%2")
+                .arg(QCoreApplication::applicationPid()).arg(++instance);
+
+        m_scenePath = m_dir.filePath(QStringLiteral("Scene.qml"));
+        m_ready = writeScene(qml) && m_bridge.loadQML(m_scenePath) && m_bridge.setupLocal(m_serverName);
+    }
+
+    bool isReady() const { return m_ready; }
+    GenericQMLBridge &bridge() { return m_bridge; }
+    int propertyId(const char *name) const { return m_bridge.propertyId(QString::fromLatin1(name)); }
+
+    // Replaces the scene file; the bridge picks it up on reloadQML()
+    bool writeScene(const QByteArray &qml)
+    {
+        QFile file(m_scenePath);
+        return file.open(QIODevice::WriteOnly) && file.write(qml) == qml.size();
+    }
+
+    // A connected client; null if it could not connect
+    std::unique_ptr<TestClient> connectClient()
+    {
+        auto client = std::make_unique<TestClient>();
+        const int before = m_bridge.connectedClients();
+        if (!client->connectTo(m_serverName)
+                || !QTest::qWaitFor([&] { return m_bridge.connectedClients() > before; }, 2000))
+            return nullptr;
+        return client;
+    }
+
+private:
+    QTemporaryDir m_dir;
+    GenericQMLBridge m_bridge;
+    QString m_serverName;
+    QString m_scenePath;
+    bool m_ready = false;
+};
+
+#endif // BRIDGEHARNESS_H
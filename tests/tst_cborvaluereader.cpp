@@ -0,0 +1,260 @@
+#include <QCborStreamWriter>
+#include <QTest>
+
+#include "cborvaluereader.hpp"
+
+namespace {
+
+// Encodes a single item with the given writer calls
+template <typename Fn>
+QByteArray encode(Fn &&write)
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    write(writer);
+    return data;
+}
+
+} // namespace
+
+class tst_CborValueReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readKey();
+    void readValueAs_data();
+    void readValueAs();
+    void naturalTypes();
+    void nullIsDefaultConstructed();
+    void failedConversionClearsOk();
+    void narrowingInRange_data();
+    void narrowingInRange();
+    void narrowingOutOfRange_data();
+    void narrowingOutOfRange();
+    void containerAsVariant();
+    void chunkedString();
+    void advancesPastItem();
+};
+
+void tst_CborValueReader::readKey()
+{
+    const QByteArray data = encode([](QCborStreamWriter &w) {
+        w.startArray(3);
+        w.append(qint64(42));
+        w.append(QLatin1String("width"));
+        w.append(1.5);
+        w.endArray();
+    });
+    QCborStreamReader reader(data);
+    QVERIFY(reader.enterContainer());
+
+    qint64 id = 0;
+    QString name = QStringLiteral("stale");
+    QVERIFY(CborValueReader::readKey(reader, &id, &name));
+    QCOMPARE(id, qint64(42));
+    QVERIFY(name.isEmpty());
+
+    QVERIFY(CborValueReader::readKey(reader, &id, &name));
+    QCOMPARE(id, qint64(-1));
+    QCOMPARE(name, QStringLiteral("width"));
+
+    // Other key types are skipped
+    QVERIFY(!CborValueReader::readKey(reader, &id, &name));
+    QVERIFY(!reader.hasNext());
+}
+
+void tst_CborValueReader::readValueAs_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("typeId");
+    QTest::addColumn<QVariant>("expected");
+
+    const auto uint7 = encode([](QCborStreamWriter &w) { w.append(quint64(7)); });
+    const auto negative = encode([](QCborStreamWriter &w) { w.append(qint64(-3)); });
+    const auto real = encode([](QCborStreamWriter &w) { w.append(2.75); });
+    const auto yes = encode([](QCborStreamWriter &w) { w.append(true); });
+    const auto numeral = encode([](QCborStreamWriter &w) { w.append(QLatin1String("12")); });
+
+    QTest::newRow("uint as int") << uint7 << QMetaType::fromType<int>().id() << QVariant(7);
+    QTest::newRow("uint as double") << uint7 << QMetaType::fromType<double>().id() << QVariant(7.0);
+    QTest::newRow("uint as bool") << uint7 << QMetaType::fromType<bool>().id() << QVariant(true);
+    QTest::newRow("negative as int") << negative << QMetaType::fromType<int>().id() << QVariant(-3);
+    QTest::newRow("negative as qint64") << negative << QMetaType::fromType<qint64>().id() << QVariant(qint64(-3));
+    QTest::newRow("double as float") << real << QMetaType::fromType<float>().id() << QVariant(2.75f);
+    QTest::newRow("double as int") << real << QMetaType::fromType<int>().id() << QVariant(2);
+    QTest::newRow("bool as int") << yes << QMetaType::fromType<int>().id() << QVariant(1);
+    QTest::newRow("string as int") << numeral << QMetaType::fromType<int>().id() << QVariant(12);
+    QTest::newRow("uint as string") << uint7 << QMetaType::fromType<QString>().id() << QVariant(QStringLiteral("7"));
+}
+
+void tst_CborValueReader::readValueAs()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, typeId);
+    QFETCH(QVariant, expected);
+
+    const QMetaType target(typeId);
+    QCborStreamReader reader(data);
+    bool ok = false;
+    const QVariant value = CborValueReader::readValue(reader, target, &ok);
+    QVERIFY(ok);
+    QCOMPARE(value.metaType(), target);
+    QCOMPARE(value, expected);
+}
+
+void tst_CborValueReader::naturalTypes()
+{
+    // Without a target, and for QVariant parameters, the CBOR type is kept
+    for (QMetaType target : { QMetaType(), QMetaType::fromType<QVariant>() }) {
+        QCborStreamReader real(encode([](QCborStreamWriter &w) { w.append(1.25); }));
+        QCOMPARE(CborValueReader::readValue(real, target), QVariant(1.25));
+
+        QCborStreamReader text(encode([](QCborStreamWriter &w) { w.append(QLatin1String("text")); }));
+        QCOMPARE(CborValueReader::readValue(text, target), QVariant(QStringLiteral("text")));
+    }
+}
+
+void tst_CborValueReader::nullIsDefaultConstructed()
+{
+    const QByteArray data = encode([](QCborStreamWriter &w) { w.appendNull(); });
+
+    QCborStreamReader reader(data);
+    bool ok = false;
+    const QVariant value = CborValueReader::readValue(reader, QMetaType::fromType<int>(), &ok);
+    QVERIFY(ok);
+    QCOMPARE(value, QVariant(0));
+
+    QCborStreamReader untyped(data);
+    QVERIFY(!CborValueReader::readValue(untyped).isValid());
+}
+
+void tst_CborValueReader::failedConversionClearsOk()
+{
+    QCborStreamReader reader(encode([](QCborStreamWriter &w) { w.append(QLatin1String("abc")); }));
+    bool ok = true;
+    CborValueReader::readValue(reader, QMetaType::fromType<int>(), &ok);
+    QVERIFY(!ok);
+}
+
+void tst_CborValueReader::narrowingInRange_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("typeId");
+    QTest::addColumn<QVariant>("expected");
+
+    const auto real = [](double value) { return encode([value](QCborStreamWriter &w) { w.append(value); }); };
+    const auto integer = [](qint64 value) { return encode([value](QCborStreamWriter &w) { w.append(value); }); };
+
+    QTest::newRow("int max as double") << real(2147483647.9) << int(QMetaType::Int) << QVariant(2147483647);
+    QTest::newRow("int min as double") << real(-2147483648.0) << int(QMetaType::Int) << QVariant(int(-2147483648LL));
+    QTest::newRow("small negative as uint") << real(-0.5) << int(QMetaType::UInt) << QVariant(0u);
+    QTest::newRow("int max") << integer(2147483647) << int(QMetaType::Int) << QVariant(2147483647);
+    QTest::newRow("negative as qint64") << integer(-5) << int(QMetaType::LongLong) << QVariant(qint64(-5));
+    QTest::newRow("NaN as float") << real(qQNaN()) << int(QMetaType::Float) << QVariant(float(qQNaN()));
+}
+
+void tst_CborValueReader::narrowingInRange()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, typeId);
+    QFETCH(QVariant, expected);
+
+    QCborStreamReader reader(data);
+    bool ok = false;
+    const QVariant value = CborValueReader::readValue(reader, QMetaType(typeId), &ok);
+    QVERIFY(ok);
+    QCOMPARE(value.metaType(), QMetaType(typeId));
+    if (typeId == QMetaType::Float)
+        QVERIFY(qIsNaN(value.toFloat()));
+    else
+        QCOMPARE(value, expected);
+}
+
+void tst_CborValueReader::narrowingOutOfRange_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("typeId");
+
+    const auto real = [](double value) { return encode([value](QCborStreamWriter &w) { w.append(value); }); };
+    const auto integer = [](qint64 value) { return encode([value](QCborStreamWriter &w) { w.append(value); }); };
+    const auto unsignedInteger = [](quint64 value) { return encode([value](QCborStreamWriter &w) { w.append(value); }); };
+
+    QTest::newRow("NaN as int") << real(qQNaN()) << int(QMetaType::Int);
+    QTest::newRow("infinity as int") << real(qInf()) << int(QMetaType::Int);
+    QTest::newRow("-infinity as qint64") << real(-qInf()) << int(QMetaType::LongLong);
+    QTest::newRow("past int max") << real(2147483648.0) << int(QMetaType::Int);
+    QTest::newRow("past qint64 max") << real(9.3e18) << int(QMetaType::LongLong);
+    QTest::newRow("negative as uint") << real(-1.0) << int(QMetaType::UInt);
+    QTest::newRow("negative as quint64") << real(-1e10) << int(QMetaType::ULongLong);
+    QTest::newRow("past float max") << real(1e39) << int(QMetaType::Float);
+    QTest::newRow("wide integer as int") << integer(qint64(1) << 32) << int(QMetaType::Int);
+    QTest::newRow("negative integer as uint") << integer(-1) << int(QMetaType::UInt);
+    QTest::newRow("large unsigned as qint64") << unsignedInteger(quint64(1) << 63) << int(QMetaType::LongLong);
+}
+
+void tst_CborValueReader::narrowingOutOfRange()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, typeId);
+
+    QCborStreamReader reader(data);
+    bool ok = true;
+    const QVariant value = CborValueReader::readValue(reader, QMetaType(typeId), &ok);
+    QVERIFY(!ok);
+    QCOMPARE(value.metaType(), QMetaType(typeId));
+    QVERIFY(reader.lastError() == QCborError::NoError);
+}
+
+void tst_CborValueReader::containerAsVariant()
+{
+    const QByteArray data = encode([](QCborStreamWriter &w) {
+        w.startMap(1);
+        w.append(QLatin1String("x"));
+        w.startArray(2);
+        w.append(qint64(1));
+        w.append(qint64(2));
+        w.endArray();
+        w.endMap();
+    });
+    QCborStreamReader reader(data);
+    const QVariantMap map = CborValueReader::readValue(reader).toMap();
+    QCOMPARE(map.value(QStringLiteral("x")).toList(), (QVariantList{ qint64(1), qint64(2) }));
+    QVERIFY(reader.lastError() == QCborError::NoError);
+}
+
+void tst_CborValueReader::chunkedString()
+{
+    // [ (_ "abc", "de") ]: an indefinite-length text string in two chunks
+    const QByteArray data = QByteArray::fromHex("81" "7f" "63616263" "626465" "ff");
+    QCborStreamReader reader(data);
+    QVERIFY(reader.enterContainer());
+    QVERIFY(reader.isString());
+    QCOMPARE(CborValueReader::readString(reader), QStringLiteral("abcde"));
+    QVERIFY(!reader.hasNext());
+}
+
+void tst_CborValueReader::advancesPastItem()
+{
+    const QByteArray data = encode([](QCborStreamWriter &w) {
+        w.startArray(4);
+        w.append(qint64(1));
+        w.append(QLatin1String("two"));
+        w.startArray(1);
+        w.append(3.0);
+        w.endArray();
+        w.append(false);
+        w.endArray();
+    });
+    QCborStreamReader reader(data);
+    QVERIFY(reader.enterContainer());
+    QVariantList values;
+    while (reader.hasNext())
+        values.append(CborValueReader::readValue(reader));
+    QCOMPARE(values.size(), 4);
+    QCOMPARE(values.last(), QVariant(false));
+    QVERIFY(reader.leaveContainer());
+}
+
+QTEST_GUILESS_MAIN(tst_CborValueReader)
+#include "tst_cborvaluereader.moc"
@@ -0,0 +1,228 @@
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "discoverycache.h"
+#include "genericqmlbridge.h"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property int value: 0
+    function reset() { value = 0 }
+}
+)";
+
+bool writeFile(const QString &path, const QByteArray &content)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+}
+
+DiscoveryCache sampleCache()
+{
+    DiscoveryCache cache;
+    DiscoveryCache::Property prop;
+    prop.id = 300;
+    prop.name = QStringLiteral("gauge.value");
+    prop.path = QStringLiteral("gauge");
+    prop.propertyIndex = 7;
+    prop.typeName = "double";
+    cache.properties.append(prop);
+    DiscoveryCache::Method method;
+    method.id = 2;
+    method.name = QStringLiteral("gauge.reset");
+    method.path = QStringLiteral("gauge");
+    method.methodIndex = 12;
+    method.signature = "reset(int,QString)";
+    method.parameterTypeNames = { "int", "QString" };
+    cache.methods.append(method);
+    return cache;
+}
+
+} // namespace
+
+class tst_DiscoveryCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void saveLoadRoundTrip();
+    void loadRejectsOtherHash();
+    void loadRejectsBadFiles_data();
+    void loadRejectsBadFiles();
+    void hashFollowsSiblingSources();
+    void hashIgnoresSubdirectoriesByDefault();
+    void hashWalksSourceRoot();
+    void bridgeUsesCacheUntilSourcesChange();
+};
+
+void tst_DiscoveryCache::saveLoadRoundTrip()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("cache/schema.cbor"));
+    QVERIFY(sampleCache().save(path, 0x1234));
+
+    DiscoveryCache loaded;
+    QVERIFY(loaded.load(path, 0x1234));
+    QCOMPARE(loaded.properties.size(), 1);
+    const DiscoveryCache::Property &prop = loaded.properties.first();
+    QCOMPARE(prop.id, quint16(300));
+    QCOMPARE(prop.name, QStringLiteral("gauge.value"));
+    QCOMPARE(prop.path, QStringLiteral("gauge"));
+    QCOMPARE(prop.propertyIndex, 7);
+    QCOMPARE(prop.typeName, QByteArray("double"));
+    QCOMPARE(loaded.methods.size(), 1);
+    const DiscoveryCache::Method &method = loaded.methods.first();
+    QCOMPARE(method.id, quint16(2));
+    QCOMPARE(method.methodIndex, 12);
+    QCOMPARE(method.signature, QByteArray("reset(int,QString)"));
+    QCOMPARE(method.parameterTypeNames, (QList<QByteArray>{ "int", "QString" }));
+}
+
+void tst_DiscoveryCache::loadRejectsOtherHash()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("schema.cbor"));
+    QVERIFY(sampleCache().save(path, 0x1234));
+    DiscoveryCache loaded;
+    QVERIFY(!loaded.load(path, 0x1235));
+}
+
+void tst_DiscoveryCache::loadRejectsBadFiles_data()
+{
+    QTest::addColumn<QByteArray>("content");
+
+    QCborMap wrongVersion;
+    wrongVersion[QStringLiteral("version")] = DiscoveryCache::FormatVersion + 1;
+    wrongVersion[QStringLiteral("hash")] = 1;
+
+    QCborMap shortEntry;
+    shortEntry[QStringLiteral("version")] = DiscoveryCache::FormatVersion;
+    shortEntry[QStringLiteral("hash")] = 1;
+    QCborArray properties;
+    properties.append(QCborArray{ 0, QStringLiteral("value") });
+    shortEntry[QStringLiteral("properties")] = properties;
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("not cbor") << QByteArray("\xff\xff garbage");
+    QTest::newRow("wrong version") << wrongVersion.toCborValue().toCbor();
+    QTest::newRow("short entry") << shortEntry.toCborValue().toCbor();
+}
+
+void tst_DiscoveryCache::loadRejectsBadFiles()
+{
+    QFETCH(QByteArray, content);
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("schema.cbor"));
+    QVERIFY(writeFile(path, content));
+    DiscoveryCache loaded;
+    QVERIFY(!loaded.load(path, 1));
+    QVERIFY(!loaded.load(dir.filePath(QStringLiteral("missing.cbor")), 1));
+}
+
+void tst_DiscoveryCache::hashFollowsSiblingSources()
+{
+    QTemporaryDir dir;
+    const QString main = dir.filePath(QStringLiteral("Main.qml"));
+    QVERIFY(writeFile(main, Scene));
+    const quint64 initial = DiscoveryCache::sourceHash(main);
+    QCOMPARE(DiscoveryCache::sourceHash(main), initial);
+
+    // Files that are not QML sources do not count
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("notes.txt")), "notes"));
+    QCOMPARE(DiscoveryCache::sourceHash(main), initial);
+
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("Gauge.qml")), "import QtQuick\nItem {}\n"));
+    const quint64 withSibling = DiscoveryCache::sourceHash(main);
+    QVERIFY(withSibling != initial);
+
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("Gauge.qml")), "import QtQuick\nRectangle {}\n"));
+    QVERIFY(DiscoveryCache::sourceHash(main) != withSibling);
+
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("logic.js")), "function f() {}\n"));
+    const quint64 withScript = DiscoveryCache::sourceHash(main);
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("qmldir")), "module Dashboard\n"));
+    QVERIFY(DiscoveryCache::sourceHash(main) != withScript);
+
+    // The same directory loaded through another file is another schema
+    QVERIFY(DiscoveryCache::sourceHash(dir.filePath(QStringLiteral("Gauge.qml")))
+            != DiscoveryCache::sourceHash(main));
+}
+
+void tst_DiscoveryCache::hashIgnoresSubdirectoriesByDefault()
+{
+    // The QML file may sit in $HOME; only its own directory is hashed
+    QTemporaryDir dir;
+    const QString main = dir.filePath(QStringLiteral("Main.qml"));
+    QVERIFY(writeFile(main, Scene));
+    const quint64 initial = DiscoveryCache::sourceHash(main);
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("components/Gauge.qml")), "import QtQuick\nItem {}\n"));
+    QCOMPARE(DiscoveryCache::sourceHash(main), initial);
+}
+
+void tst_DiscoveryCache::hashWalksSourceRoot()
+{
+    QTemporaryDir dir;
+    const QString main = dir.filePath(QStringLiteral("app/Main.qml"));
+    QVERIFY(writeFile(main, Scene));
+    const QString nested = dir.filePath(QStringLiteral("app/components/Gauge.qml"));
+    QVERIFY(writeFile(nested, "import QtQuick\nItem {}\n"));
+    const quint64 initial = DiscoveryCache::sourceHash(main, dir.path());
+
+    QVERIFY(writeFile(nested, "import QtQuick\nRectangle {}\n"));
+    QVERIFY(DiscoveryCache::sourceHash(main, dir.path()) != initial);
+}
+
+void tst_DiscoveryCache::bridgeUsesCacheUntilSourcesChange()
+{
+    QTemporaryDir dir;
+    const QString qmlFile = dir.filePath(QStringLiteral("Main.qml"));
+    const QString cachePath = dir.filePath(QStringLiteral("schema.cbor"));
+    QVERIFY(writeFile(qmlFile, Scene));
+
+    int scannedId = -1;
+    {
+        GenericQMLBridge bridge;
+        bridge.setDiscoveryCache(cachePath);
+        QVERIFY(bridge.loadQML(qmlFile));
+        scannedId = bridge.propertyId(QStringLiteral("value"));
+        QVERIFY(scannedId >= 0);
+    }
+
+    // Move every cached ID, so a bridge that starts from the cache is told
+    // apart from one that scanned the scene again
+    const quint64 hash = DiscoveryCache::sourceHash(qmlFile);
+    DiscoveryCache cache;
+    QVERIFY(cache.load(cachePath, hash));
+    for (DiscoveryCache::Property &prop : cache.properties)
+        prop.id += 1000;
+    QVERIFY(cache.save(cachePath, hash));
+    {
+        GenericQMLBridge bridge;
+        bridge.setDiscoveryCache(cachePath);
+        QVERIFY(bridge.loadQML(qmlFile));
+        QCOMPARE(bridge.propertyId(QStringLiteral("value")), scannedId + 1000);
+    }
+
+    // A new file next to the scene invalidates the cache
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("Gauge.qml")), "import QtQuick\nItem {}\n"));
+    {
+        GenericQMLBridge bridge;
+        bridge.setDiscoveryCache(cachePath);
+        QVERIFY(bridge.loadQML(qmlFile));
+        QCOMPARE(bridge.propertyId(QStringLiteral("value")), scannedId);
+    }
+}
+
+QTEST_MAIN(tst_DiscoveryCache)
+#include "tst_discoverycache.moc"
@@ -0,0 +1,104 @@
+#include <QCborArray>
+#include <QCborStreamReader>
+#include <QTest>
+
+#include "bridgeharness.h"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property int count: 0
+    property string label: ""
+}
+)";
+
+// label is gone, extra is new and count keeps its name and type
+const QByteArray EditedScene = R"(
+import QtQuick
+
+Item {
+    property int count: 0
+    property real extra: 0
+}
+)";
+
+} // namespace
+
+class tst_HotReload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void keepsIdsValuesAndWatches();
+
+private:
+    std::unique_ptr<BridgeHarness> m_harness;
+};
+
+void tst_HotReload::init()
+{
+    m_harness = std::make_unique<BridgeHarness>(Scene);
+    QVERIFY(m_harness->isReady());
+}
+
+void tst_HotReload::cleanup()
+{
+    m_harness.reset();
+}
+
+void tst_HotReload::keepsIdsValuesAndWatches()
+{
+    const int count = m_harness->propertyId("count");
+    const int label = m_harness->propertyId("label");
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    // Only clients that have the property list are sent deltas
+    client->send(GenericQMLBridge::CMD_GET_PROPERTY_LIST);
+    QVERIFY(!client->next(GenericQMLBridge::RESP_GET_PROPERTY_LIST).isNull());
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ count });
+    QCborMap values;
+    values.insert(count, 5);
+    client->send(GenericQMLBridge::CMD_SET_PROPERTY, values);
+    client->sync();
+
+    QVERIFY(m_harness->writeScene(EditedScene));
+    m_harness->bridge().reloadQML();
+
+    const QCborMap delta = QCborValue::fromCbor(client->next(GenericQMLBridge::RESP_SCHEMA_DELTA)).toMap();
+    QCOMPARE(delta.value(QLatin1String("removed")).toArray(), QCborArray{ QLatin1String("label") });
+    const QCborMap added = delta.value(QLatin1String("added")).toMap();
+    QCOMPARE(added.size(), 1);
+    QVERIFY(added.contains(QLatin1String("extra")));
+
+    // Unchanged names keep their IDs, and new names do not reuse old ones
+    QCOMPARE(m_harness->propertyId("count"), count);
+    const int extra = m_harness->propertyId("extra");
+    QVERIFY(extra >= 0);
+    QVERIFY(extra != count && extra != label);
+    QCOMPARE(added.value(QLatin1String("extra")).toMap().value(QLatin1String("id")).toInteger(), qint64(extra));
+
+    // The value the client wrote is written again into the new scene
+    client->send(GenericQMLBridge::CMD_READ_VALUES, QCborArray{ count });
+    QCborStreamReader reader(client->next(GenericQMLBridge::RESP_VALUES));
+    QCborValue::fromCbor(reader);
+    QCOMPARE(QCborValue::fromCbor(reader).toMap().value(count).toInteger(), qint64(5));
+
+    // And the watch is still in place
+    values = QCborMap();
+    values.insert(count, 6);
+    m_harness->bridge().processCommand(QByteArray(1, char(GenericQMLBridge::CMD_SET_PROPERTY)) + values.toCbor());
+    QCborMap change;
+    do {
+        change = client->nextChange();
+    } while (!change.isEmpty() && change.value(count).toInteger() != 6);
+    QVERIFY(!change.isEmpty());
+}
+
+QTEST_MAIN(tst_HotReload)
+#include "tst_hotreload.moc"
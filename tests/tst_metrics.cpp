@@ -0,0 +1,124 @@
+#include <QCborArray>
+#include <QTest>
+
+#include "genericqmlbridge.h"
+#include "metrics.h"
+
+namespace {
+
+IoMetrics sampleIo()
+{
+    IoMetrics io;
+    IoMetrics::Transport tcp;
+    tcp.name = QStringLiteral("tcp:9000");
+    tcp.framesIn = 3;
+    tcp.queueDropped = 2;
+    io.transports << tcp;
+    io.rings << IoMetrics::Ring{ QStringLiteral("inbound"), 128, 4096, 1 };
+    IoMetrics::Session session;
+    session.id = 7;
+    session.transport = tcp.name;
+    session.queuedBytes = 512;
+    session.droppedFrames = 2;
+    session.congested = true;
+    io.sessions << session;
+    return io;
+}
+
+} // namespace
+
+class tst_Metrics : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void histogramBuckets();
+    void cborSnapshot();
+    void prometheusText();
+    void unnamedCommandUsesCode();
+};
+
+void tst_Metrics::histogramBuckets()
+{
+    MetricsHistogram h;
+    h.observe(0);
+    h.observe(1000);       // on a bound: counts in that bucket
+    h.observe(1001);
+    h.observe(200000000);  // past the last bound
+    QCOMPARE(h.count(), quint64(4));
+    QCOMPARE(h.sum(), qint64(200002001));
+    QCOMPARE(h.bucket(0), quint64(2));
+    QCOMPARE(h.bucket(1), quint64(1));
+    QCOMPARE(h.bucket(MetricsHistogram::BucketBounds.size()), quint64(1));
+}
+
+void tst_Metrics::cborSnapshot()
+{
+    BridgeMetrics metrics(QMetaEnum::fromType<GenericQMLBridge::ProtocolCommand>());
+    metrics.recordCommand(GenericQMLBridge::CMD_SET_PROPERTY, 2000);
+    metrics.recordCommand(GenericQMLBridge::CMD_SET_PROPERTY, 30000);
+    metrics.countUnknownId();
+    metrics.countPublished(5);
+    metrics.countCoalesced();
+
+    const QCborMap cbor = metrics.toCbor(sampleIo());
+    const QCborMap tcp = cbor.value(QLatin1String("transports")).toMap().value(QLatin1String("tcp:9000")).toMap();
+    QCOMPARE(tcp.value(QLatin1String("frames_in")).toInteger(), qint64(3));
+    QCOMPARE(tcp.value(QLatin1String("queue_dropped")).toInteger(), qint64(2));
+
+    const QCborMap ring = cbor.value(QLatin1String("rings")).toMap().value(QLatin1String("inbound")).toMap();
+    QCOMPARE(ring.value(QLatin1String("used")).toInteger(), qint64(128));
+    QCOMPARE(ring.value(QLatin1String("capacity")).toInteger(), qint64(4096));
+
+    const QCborArray sessions = cbor.value(QLatin1String("sessions")).toArray();
+    QCOMPARE(sessions.size(), 1);
+    const QCborMap session = sessions.at(0).toMap();
+    QCOMPARE(session.value(QLatin1String("id")).toInteger(), qint64(7));
+    QCOMPARE(session.value(QLatin1String("queued_bytes")).toInteger(), qint64(512));
+    QCOMPARE(session.value(QLatin1String("congested")).toBool(), true);
+
+    // Only commands that ran are listed, by name
+    const QCborMap commands = cbor.value(QLatin1String("commands")).toMap();
+    QCOMPARE(commands.size(), 1);
+    const QCborMap set = commands.value(QLatin1String("CMD_SET_PROPERTY")).toMap();
+    QCOMPARE(set.value(QLatin1String("count")).toInteger(), qint64(2));
+    QCOMPARE(set.value(QLatin1String("sum_us")).toDouble(), 32.0);
+    const QCborArray buckets = set.value(QLatin1String("buckets")).toArray();
+    QCOMPARE(buckets.size(), qsizetype(MetricsHistogram::BucketBounds.size()));
+    // [upper bound in us, cumulative count]
+    QCOMPARE(buckets.at(1).toArray().at(0).toDouble(), 2.5);
+    QCOMPARE(buckets.at(1).toArray().at(1).toInteger(), qint64(1));
+    QCOMPARE(buckets.last().toArray().at(1).toInteger(), qint64(2));
+
+    QCOMPARE(cbor.value(QLatin1String("unknown_ids")).toInteger(), qint64(1));
+    QCOMPARE(cbor.value(QLatin1String("published_changes")).toInteger(), qint64(5));
+    QCOMPARE(cbor.value(QLatin1String("coalesced_writes")).toInteger(), qint64(1));
+}
+
+void tst_Metrics::prometheusText()
+{
+    BridgeMetrics metrics(QMetaEnum::fromType<GenericQMLBridge::ProtocolCommand>());
+    metrics.recordCommand(GenericQMLBridge::CMD_READ_VALUES, 2000);
+    const QByteArray text = metrics.toPrometheus(sampleIo());
+
+    QVERIFY(text.contains("# TYPE qml_remoteserver_frames_in_total counter\n"));
+    QVERIFY(text.contains("qml_remoteserver_frames_in_total{transport=\"tcp:9000\"} 3\n"));
+    QVERIFY(text.contains("qml_remoteserver_send_queue_dropped_total{transport=\"tcp:9000\"} 2\n"));
+    QVERIFY(text.contains("qml_remoteserver_ring_used_bytes{ring=\"inbound\"} 128\n"));
+    QVERIFY(text.contains("qml_remoteserver_session_queued_bytes{session=\"7\",transport=\"tcp:9000\"} 512\n"));
+    QVERIFY(text.contains("# TYPE qml_remoteserver_command_duration_seconds histogram\n"));
+    QVERIFY(text.contains("qml_remoteserver_command_duration_seconds_bucket{command=\"CMD_READ_VALUES\",le=\"+Inf\"} 1\n"));
+    QVERIFY(text.contains("qml_remoteserver_command_duration_seconds_count{command=\"CMD_READ_VALUES\"} 1\n"));
+    QVERIFY(text.endsWith('\n'));
+}
+
+void tst_Metrics::unnamedCommandUsesCode()
+{
+    BridgeMetrics metrics(QMetaEnum::fromType<GenericQMLBridge::ProtocolCommand>());
+    metrics.recordCommand(0x7F, 1000);
+    const QCborMap commands = metrics.toCbor(IoMetrics()).value(QLatin1String("commands")).toMap();
+    QVERIFY(commands.contains(QLatin1String("0x7f")));
+}
+
+QTEST_GUILESS_MAIN(tst_Metrics)
+#include "tst_metrics.moc"
@@ -0,0 +1,272 @@
+#include <QCborArray>
+#include <QCborStreamReader>
+#include <QTest>
+#include <QtEndian>
+
+#include "bridgeharness.h"
+#include "dataencoder.hpp"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property bool flag: false
+    property int count: 0
+    property real level: 0
+    property string label: ""
+}
+)";
+
+template <typename T>
+QByteArray bytes(T value, bool bigEndian)
+{
+    QByteArray out(qsizetype(sizeof(T)), Qt::Uninitialized);
+    if (bigEndian)
+        qToBigEndian<T>(value, out.data());
+    else
+        qToLittleEndian<T>(value, out.data());
+    return out;
+}
+
+QByteArray packedId(int id, bool wide)
+{
+    return wide ? bytes<quint16>(quint16(id), true) : QByteArray(1, char(id));
+}
+
+// Splits RESP_PROPERTY_CHANGE_PACKED records into {id: value bytes};
+// widths maps each ID to its value size
+bool splitRecords(const QByteArray &payload, bool wide, const QHash<int, int> &widths,
+                  QHash<int, QByteArray> *records)
+{
+    const int idSize = wide ? 2 : 1;
+    for (qsizetype offset = 0; offset < payload.size();) {
+        if (offset + idSize > payload.size())
+            return false;
+        const int id = wide ? qFromBigEndian<quint16>(payload.constData() + offset)
+                            : quint8(payload.at(offset));
+        offset += idSize;
+        const int width = widths.value(id, -1);
+        if (width < 0 || offset + width > payload.size())
+            return false;
+        records->insert(id, payload.mid(offset, width));
+        offset += width;
+    }
+    return true;
+}
+
+// The {id: value} map of a RESP_VALUES payload, after its version
+QCborMap valuesOf(const QByteArray &payload)
+{
+    QCborStreamReader reader(payload);
+    QCborValue::fromCbor(reader);
+    return QCborValue::fromCbor(reader).toMap();
+}
+
+} // namespace
+
+class tst_PackedRecords : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void encoderRoundTrip_data();
+    void encoderRoundTrip();
+    void decoderRejectsShortInput();
+    void wireTypesInPropertyList();
+    void packedChanges_data();
+    void packedChanges();
+    void setPropertyPacked_data();
+    void setPropertyPacked();
+    void unpackableRecordEndsFrame();
+
+private:
+    std::unique_ptr<BridgeHarness> m_harness;
+};
+
+void tst_PackedRecords::init()
+{
+    m_harness = std::make_unique<BridgeHarness>(Scene);
+    QVERIFY(m_harness->isReady());
+}
+
+void tst_PackedRecords::cleanup()
+{
+    m_harness.reset();
+}
+
+void tst_PackedRecords::encoderRoundTrip_data()
+{
+    QTest::addColumn<bool>("bigEndian");
+    QTest::newRow("little") << false;
+    QTest::newRow("big") << true;
+}
+
+void tst_PackedRecords::encoderRoundTrip()
+{
+    QFETCH(bool, bigEndian);
+    const auto order = bigEndian ? DataDecoder::BigEndian : DataDecoder::LittleEndian;
+    DataEncoder encoder;
+    encoder.setEndianess(order);
+    DataDecoder decoder;
+    decoder.setEndianess(order);
+
+    QByteArray data;
+    encoder.encodeBool(data, true);
+    encoder.encodeInt32(data, -123456789);
+    encoder.encodeFloat(data, 1.5f);
+    encoder.encodeDouble(data, 0.1);
+    QCOMPARE(data.size(), 1 + 4 + 4 + 8);
+    QCOMPARE(data.mid(1, 4), bytes<qint32>(-123456789, bigEndian));
+    QCOMPARE(data.mid(9, 8), bytes<double>(0.1, bigEndian));
+
+    QCOMPARE(decoder.decodeBool(data, 0).toBool(), true);
+    QCOMPARE(decoder.decodeInt32(data, 1).toInt(), -123456789);
+    QCOMPARE(decoder.decodeFloat(data, 5).toFloat(), 1.5f);
+    QCOMPARE(decoder.decodeDouble(data, 9).toDouble(), 0.1);
+    QCOMPARE(decoder.decodeInt16(bytes<qint16>(-1234, bigEndian)).toInt(), -1234);
+}
+
+void tst_PackedRecords::decoderRejectsShortInput()
+{
+    DataDecoder decoder;
+    const QByteArray data(7, '\0');
+    QVERIFY(!decoder.decodeDouble(data).isValid());
+    QVERIFY(!decoder.decodeInt32(data, 4).isValid());
+    QVERIFY(!decoder.decodeBool(data, 7).isValid());
+    QVERIFY(decoder.decodeInt32(data, 3).isValid());
+}
+
+void tst_PackedRecords::wireTypesInPropertyList()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_GET_PROPERTY_LIST);
+    const QCborMap list = QCborValue::fromCbor(client->next(GenericQMLBridge::RESP_GET_PROPERTY_LIST)).toMap();
+
+    auto wireOf = [&list](const char *name) {
+        return list.value(QLatin1String(name)).toMap().value(QLatin1String("wire")).toString();
+    };
+    QCOMPARE(wireOf("flag"), QStringLiteral("bool"));
+    QCOMPARE(wireOf("count"), QStringLiteral("i32"));
+    // QML real is a double and must not be narrowed to f32
+    QCOMPARE(wireOf("level"), QStringLiteral("f64"));
+    QVERIFY(!list.value(QLatin1String("label")).toMap().contains(QLatin1String("wire")));
+}
+
+void tst_PackedRecords::packedChanges_data()
+{
+    QTest::addColumn<bool>("wide");
+    QTest::addColumn<bool>("bigEndian");
+    QTest::newRow("narrow little") << false << false;
+    QTest::newRow("narrow big") << false << true;
+    QTest::newRow("wide little") << true << false;
+    QTest::newRow("wide big") << true << true;
+}
+
+void tst_PackedRecords::packedChanges()
+{
+    QFETCH(bool, wide);
+    QFETCH(bool, bigEndian);
+    const int flag = m_harness->propertyId("flag");
+    const int count = m_harness->propertyId("count");
+    const int level = m_harness->propertyId("level");
+    const int label = m_harness->propertyId("label");
+
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    QCborMap options;
+    options.insert(QLatin1String("packed"), true);
+    options.insert(QLatin1String("wide"), wide);
+    options.insert(QLatin1String("endian"), bigEndian ? QLatin1String("big") : QLatin1String("little"));
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ flag, count, level, label });
+    QVERIFY(client->sync(options).value(QLatin1String("packed")).toBool());
+
+    QCborMap values;
+    values.insert(flag, true);
+    values.insert(count, -2);
+    values.insert(level, 0.1);
+    values.insert(label, QLatin1String("x"));
+    client->send(GenericQMLBridge::CMD_SET_PROPERTY, values);
+
+    // The packable changes may be split over several flushes
+    const QHash<int, int> widths = { { flag, 1 }, { count, 4 }, { level, 8 } };
+    QHash<int, QByteArray> records;
+    while (records.size() < widths.size()) {
+        const QByteArray payload = client->next(GenericQMLBridge::RESP_PROPERTY_CHANGE_PACKED);
+        QVERIFY(!payload.isEmpty());
+        QVERIFY(splitRecords(payload, wide, widths, &records));
+    }
+    QCOMPARE(records.value(flag), QByteArray(1, '\1'));
+    QCOMPARE(records.value(count), bytes<qint32>(-2, bigEndian));
+    QCOMPARE(records.value(level), bytes<double>(0.1, bigEndian));
+
+    // Strings have no wire type and fall back to a CBOR change frame
+    client->clear();
+    values = QCborMap();
+    values.insert(label, QLatin1String("y"));
+    client->send(GenericQMLBridge::CMD_SET_PROPERTY, values);
+    QCOMPARE(client->nextChange().value(label).toString(), QStringLiteral("y"));
+}
+
+void tst_PackedRecords::setPropertyPacked_data()
+{
+    packedChanges_data();
+}
+
+void tst_PackedRecords::setPropertyPacked()
+{
+    QFETCH(bool, wide);
+    QFETCH(bool, bigEndian);
+    const int flag = m_harness->propertyId("flag");
+    const int count = m_harness->propertyId("count");
+    const int level = m_harness->propertyId("level");
+
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    QCborMap options;
+    options.insert(QLatin1String("wide"), wide);
+    options.insert(QLatin1String("endian"), bigEndian ? QLatin1String("big") : QLatin1String("little"));
+    client->sync(options);
+
+    QByteArray packet(1, char(GenericQMLBridge::CMD_SET_PROPERTY_PACKED));
+    packet += packedId(level, wide) + bytes<double>(6.25, bigEndian);
+    packet += packedId(count, wide) + bytes<qint32>(42, bigEndian);
+    packet += packedId(flag, wide) + QByteArray(1, '\1');
+    client->sendPacket(packet);
+
+    client->send(GenericQMLBridge::CMD_READ_VALUES, QCborArray{ flag, count, level });
+    const QCborMap values = valuesOf(client->next(GenericQMLBridge::RESP_VALUES));
+    QCOMPARE(values.value(level).toDouble(), 6.25);
+    QCOMPARE(values.value(count).toInteger(), qint64(42));
+    QCOMPARE(values.value(flag).toBool(), true);
+}
+
+void tst_PackedRecords::unpackableRecordEndsFrame()
+{
+    // The server cannot tell the size of a record without a wire type, so
+    // nothing after it is applied
+    const int flag = m_harness->propertyId("flag");
+    const int count = m_harness->propertyId("count");
+    const int label = m_harness->propertyId("label");
+
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    QByteArray packet(1, char(GenericQMLBridge::CMD_SET_PROPERTY_PACKED));
+    packet += packedId(count, false) + bytes<qint32>(5, false);
+    packet += packedId(label, false) + QByteArray(4, 'x');
+    packet += packedId(flag, false) + QByteArray(1, '\1');
+    client->sendPacket(packet);
+
+    client->send(GenericQMLBridge::CMD_READ_VALUES, QCborArray{ flag, count });
+    const QCborMap values = valuesOf(client->next(GenericQMLBridge::RESP_VALUES));
+    QCOMPARE(values.value(count).toInteger(), qint64(5));
+    QCOMPARE(values.value(flag).toBool(), false);
+}
+
+QTEST_MAIN(tst_PackedRecords)
+#include "tst_packedrecords.moc"
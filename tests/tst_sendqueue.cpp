@@ -0,0 +1,174 @@
+#include <QCborArray>
+#include <QTest>
+
+#include "bridgeharness.h"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property int count: 0
+    property string label: ""
+}
+)";
+
+// The smallest limit IoWorker accepts
+constexpr qint64 QueueLimit = 4096;
+// Each READ_VALUES of the label is one frame of about this size
+constexpr int LabelSize = 64 * 1024;
+// Enough frames to fill the socket buffers several times over
+constexpr int FloodFrames = 40;
+
+} // namespace
+
+class tst_SendQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void dropOldestBoundsQueue();
+    void disconnectDropsClient();
+    void collapseSendsLatestWhenCaughtUp();
+
+private:
+    // Connects a client that stops reading, plus one that reads the metrics
+    void connectClients(IoWorker::QueuePolicy policy);
+    void flood();
+    QCborMap metrics();
+    qint64 transportTotal(const char *key);
+    QCborMap stalledSession();
+
+    std::unique_ptr<BridgeHarness> m_harness;
+    std::unique_ptr<TestClient> m_stalled;
+    std::unique_ptr<TestClient> m_observer;
+    int m_count = -1;
+    int m_label = -1;
+};
+
+void tst_SendQueue::init()
+{
+    m_harness = std::make_unique<BridgeHarness>(Scene);
+    QVERIFY(m_harness->isReady());
+    m_count = m_harness->propertyId("count");
+    m_label = m_harness->propertyId("label");
+
+    QCborMap values;
+    values.insert(m_label, QString(LabelSize, QLatin1Char('x')));
+    m_harness->bridge().processCommand(QByteArray(1, char(GenericQMLBridge::CMD_SET_PROPERTY)) + values.toCbor());
+}
+
+void tst_SendQueue::cleanup()
+{
+    m_stalled.reset();
+    m_observer.reset();
+    m_harness.reset();
+}
+
+void tst_SendQueue::connectClients(IoWorker::QueuePolicy policy)
+{
+    m_harness->bridge().setSendQueue(policy, QueueLimit);
+    m_stalled = m_harness->connectClient();
+    m_observer = m_harness->connectClient();
+    QVERIFY(m_stalled);
+    QVERIFY(m_observer);
+    m_stalled->pause();
+}
+
+void tst_SendQueue::flood()
+{
+    for (int i = 0; i < FloodFrames; ++i)
+        m_stalled->send(GenericQMLBridge::CMD_READ_VALUES, QCborArray{ m_label });
+}
+
+QCborMap tst_SendQueue::metrics()
+{
+    m_observer->send(GenericQMLBridge::CMD_GET_METRICS);
+    return QCborValue::fromCbor(m_observer->next(GenericQMLBridge::RESP_METRICS)).toMap();
+}
+
+qint64 tst_SendQueue::transportTotal(const char *key)
+{
+    qint64 total = 0;
+    const QCborMap transports = metrics().value(QLatin1String("transports")).toMap();
+    for (auto it = transports.constBegin(); it != transports.constEnd(); ++it)
+        total += it.value().toMap().value(QLatin1String(key)).toInteger();
+    return total;
+}
+
+QCborMap tst_SendQueue::stalledSession()
+{
+    // The observer reads everything, so the session with the most waiting
+    // is the stalled one
+    QCborMap stalled;
+    const QCborArray sessions = metrics().value(QLatin1String("sessions")).toArray();
+    for (const QCborValue &session : sessions) {
+        const QCborMap entry = session.toMap();
+        if (stalled.isEmpty() || entry.value(QLatin1String("queued_bytes")).toInteger()
+                > stalled.value(QLatin1String("queued_bytes")).toInteger())
+            stalled = entry;
+    }
+    return stalled;
+}
+
+void tst_SendQueue::dropOldestBoundsQueue()
+{
+    connectClients(IoWorker::DropOldest);
+    flood();
+    QTRY_VERIFY_WITH_TIMEOUT(transportTotal("queue_dropped") > 0, 5000);
+
+    // Past the socket buffers only about a limit's worth is kept, and at
+    // least the newest frame
+    const QCborMap session = stalledSession();
+    QVERIFY(session.value(QLatin1String("congested")).toBool());
+    QVERIFY(session.value(QLatin1String("dropped")).toInteger() > 0);
+    QVERIFY(session.value(QLatin1String("queued_bytes")).toInteger() < 4 * LabelSize);
+    QCOMPARE(m_harness->bridge().connectedClients(), 2);
+
+    m_stalled->resume();
+    QTRY_VERIFY_WITH_TIMEOUT(!stalledSession().value(QLatin1String("congested")).toBool(), 5000);
+    int received = 0;
+    while (!m_stalled->next(GenericQMLBridge::RESP_VALUES, 300).isNull())
+        ++received;
+    QVERIFY(received > 0);
+    QVERIFY(received < FloodFrames);
+}
+
+void tst_SendQueue::disconnectDropsClient()
+{
+    connectClients(IoWorker::Disconnect);
+    flood();
+    QTRY_COMPARE_WITH_TIMEOUT(m_harness->bridge().connectedClients(), 1, 5000);
+    QCOMPARE(transportTotal("queue_disconnects"), qint64(1));
+    QCOMPARE(transportTotal("queue_dropped"), qint64(0));
+}
+
+void tst_SendQueue::collapseSendsLatestWhenCaughtUp()
+{
+    connectClients(IoWorker::CollapseLatest);
+    m_stalled->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_count });
+    flood();
+    QTRY_VERIFY_WITH_TIMEOUT(stalledSession().value(QLatin1String("congested")).toBool(), 5000);
+
+    // Several flushes while the client is behind
+    for (int value = 1; value <= 5; ++value) {
+        QCborMap values;
+        values.insert(m_count, value);
+        m_harness->bridge().processCommand(QByteArray(1, char(GenericQMLBridge::CMD_SET_PROPERTY)) + values.toCbor());
+        QTest::qWait(50);
+    }
+
+    // Held back rather than queued: one catch-up frame with the latest value
+    m_stalled->resume();
+    QList<qint64> sent;
+    for (QCborMap change = m_stalled->nextChange(); !change.isEmpty(); change = m_stalled->nextChange(300))
+        sent.append(change.value(m_count).toInteger());
+    QCOMPARE(sent, QList<qint64>{ 5 });
+}
+
+QTEST_MAIN(tst_SendQueue)
+#include "tst_sendqueue.moc"
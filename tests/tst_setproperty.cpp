@@ -0,0 +1,106 @@
+#include <QCborArray>
+#include <QCborStreamReader>
+#include <QTest>
+
+#include "bridgeharness.h"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property int count: 7
+    property real level: 1.5
+    property color tint: "red"
+}
+)";
+
+} // namespace
+
+class tst_SetProperty : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void convertsToPropertyType();
+    void valueThatDoesNotConvertIsIgnored_data();
+    void valueThatDoesNotConvertIsIgnored();
+
+private:
+    // Sends SET_PROPERTY and reads the properties back with READ_VALUES
+    QCborMap setAndRead(const QCborMap &values);
+
+    std::unique_ptr<BridgeHarness> m_harness;
+    std::unique_ptr<TestClient> m_client;
+};
+
+void tst_SetProperty::init()
+{
+    m_harness = std::make_unique<BridgeHarness>(Scene);
+    QVERIFY(m_harness->isReady());
+    m_client = m_harness->connectClient();
+    QVERIFY(m_client);
+}
+
+void tst_SetProperty::cleanup()
+{
+    m_client.reset();
+    m_harness.reset();
+}
+
+QCborMap tst_SetProperty::setAndRead(const QCborMap &values)
+{
+    m_client->send(GenericQMLBridge::CMD_SET_PROPERTY, values);
+    m_client->send(GenericQMLBridge::CMD_READ_VALUES);
+    QCborStreamReader reader(m_client->next(GenericQMLBridge::RESP_VALUES));
+    QCborValue::fromCbor(reader);
+    return QCborValue::fromCbor(reader).toMap();
+}
+
+void tst_SetProperty::convertsToPropertyType()
+{
+    const int count = m_harness->propertyId("count");
+    const int level = m_harness->propertyId("level");
+    QCborMap values;
+    values.insert(count, QLatin1String("12"));
+    values.insert(level, 3);
+    const QCborMap read = setAndRead(values);
+    QCOMPARE(read.value(count).toInteger(), qint64(12));
+    QCOMPARE(read.value(level).toDouble(), 3.0);
+}
+
+void tst_SetProperty::valueThatDoesNotConvertIsIgnored_data()
+{
+    QTest::addColumn<QByteArray>("property");
+    QTest::addColumn<QCborValue>("value");
+
+    QTest::newRow("text for int") << QByteArray("count") << QCborValue(QLatin1String("abc"));
+    QTest::newRow("NaN for int") << QByteArray("count") << QCborValue(qQNaN());
+    QTest::newRow("infinity for int") << QByteArray("count") << QCborValue(qInf());
+    QTest::newRow("too large for int") << QByteArray("count") << QCborValue(1e12);
+    QTest::newRow("number for color") << QByteArray("tint") << QCborValue(42);
+}
+
+void tst_SetProperty::valueThatDoesNotConvertIsIgnored()
+{
+    QFETCH(QByteArray, property);
+    QFETCH(QCborValue, value);
+    const int id = m_harness->propertyId(property.constData());
+    const int level = m_harness->propertyId("level");
+    const QCborMap before = setAndRead(QCborMap());
+
+    // The rest of the map still applies
+    QCborMap values;
+    values.insert(id, value);
+    values.insert(level, 2.5);
+    const QCborMap after = setAndRead(values);
+    QCOMPARE(after.value(id), before.value(id));
+    QCOMPARE(after.value(level).toDouble(), 2.5);
+}
+
+QTEST_MAIN(tst_SetProperty)
+#include "tst_setproperty.moc"
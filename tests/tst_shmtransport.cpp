@@ -0,0 +1,202 @@
+#include <QCoreApplication>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <thread>
+
+#include "shmtransport.h"
+
+namespace {
+
+// The smallest ring ShmTransport creates
+constexpr quint32 Capacity = 64;
+
+struct Update {
+    quint16 id;
+    quint8 type;
+    qint64 value;
+};
+
+// Opens the producer on another thread: it blocks until the server, on
+// this thread, hands over the eventfd
+bool openProducer(ShmUpdateProducer &producer, const QByteArray &name)
+{
+    std::atomic<int> result{ -1 };
+    std::thread thread([&] { result = producer.open(name.constData()) ? 1 : 0; });
+    QTest::qWaitFor([&] { return result >= 0; }, 5000);
+    thread.join();
+    return result == 1;
+}
+
+// The segment as a producer sees it, to put head and tail where a test
+// needs them
+class Segment
+{
+public:
+    explicit Segment(const QByteArray &name)
+    {
+        const int fd = shm_open(('/' + name).constData(), O_RDWR, 0);
+        if (fd < 0)
+            return;
+        void *map = mmap(nullptr, sizeof(ShmUpdateRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map != MAP_FAILED)
+            m_header = static_cast<ShmUpdateRingHeader *>(map);
+    }
+    ~Segment()
+    {
+        if (m_header)
+            munmap(m_header, sizeof(ShmUpdateRingHeader));
+    }
+
+    ShmUpdateRingHeader *header() const { return m_header; }
+
+private:
+    ShmUpdateRingHeader *m_header = nullptr;
+};
+
+} // namespace
+
+class tst_ShmTransport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void capacityIsRoundedUp();
+    void drainsInOrder();
+    void wrapsAround();
+    void fullRingDropsRecords();
+    void bogusTailIsClamped();
+
+private:
+    QList<Update> drain();
+
+    QByteArray m_name;
+    std::unique_ptr<ShmTransport> m_transport;
+    std::unique_ptr<ShmUpdateProducer> m_producer;
+};
+
+void tst_ShmTransport::init()
+{
+    m_name = QByteArray("tst_shmtransport-") + QByteArray::number(QCoreApplication::applicationPid());
+    m_transport = std::make_unique<ShmTransport>();
+    QVERIFY2(m_transport->open(QString::fromLatin1(m_name), 1), qPrintable(m_transport->errorString()));
+    m_producer = std::make_unique<ShmUpdateProducer>();
+    QVERIFY(openProducer(*m_producer, m_name));
+}
+
+void tst_ShmTransport::cleanup()
+{
+    m_producer.reset();
+    m_transport.reset();
+}
+
+QList<Update> tst_ShmTransport::drain()
+{
+    QList<Update> updates;
+    m_transport->drain([&updates](const ShmUpdateRecord &record) {
+        updates.append({ record.id, record.type, record.value.i });
+    });
+    return updates;
+}
+
+void tst_ShmTransport::capacityIsRoundedUp()
+{
+    QCOMPARE(m_transport->capacityBytes(), quint64(Capacity * sizeof(ShmUpdateRecord)));
+
+    ShmTransport larger;
+    QVERIFY(larger.open(QString::fromLatin1(m_name + "-larger"), 100));
+    QCOMPARE(larger.capacityBytes(), quint64(128 * sizeof(ShmUpdateRecord)));
+}
+
+void tst_ShmTransport::drainsInOrder()
+{
+    QSignalSpy ready(m_transport.get(), &ShmTransport::updatesReady);
+    QVERIFY(m_producer->pushBool(1, true));
+    QVERIFY(m_producer->pushInt(2, -7));
+    QVERIFY(m_producer->pushDouble(3, 0.5));
+    QVERIFY(ready.wait(2000));
+    QCOMPARE(m_transport->usedBytes(), quint64(3 * sizeof(ShmUpdateRecord)));
+
+    QList<Update> updates;
+    const qsizetype count = m_transport->drain([&updates](const ShmUpdateRecord &record) {
+        updates.append({ record.id, record.type, record.value.i });
+        if (record.type == ShmUpdateDouble)
+            QCOMPARE(record.value.d, 0.5);
+    });
+    QCOMPARE(count, qsizetype(3));
+    QCOMPARE(updates.size(), 3);
+    QCOMPARE(updates.at(0).id, quint16(1));
+    QCOMPARE(updates.at(0).type, quint8(ShmUpdateBool));
+    QCOMPARE(updates.at(0).value, qint64(1));
+    QCOMPARE(updates.at(1).id, quint16(2));
+    QCOMPARE(updates.at(1).type, quint8(ShmUpdateInt));
+    QCOMPARE(updates.at(1).value, qint64(-7));
+    QCOMPARE(updates.at(2).id, quint16(3));
+    QCOMPARE(updates.at(2).type, quint8(ShmUpdateDouble));
+    QCOMPARE(m_transport->usedBytes(), quint64(0));
+    QVERIFY(drain().isEmpty());
+}
+
+void tst_ShmTransport::wrapsAround()
+{
+    // Move the ring most of the way round first
+    for (int i = 0; i < 40; ++i)
+        QVERIFY(m_producer->pushInt(0, i));
+    QCOMPARE(drain().size(), 40);
+
+    for (int i = 0; i < 60; ++i)
+        QVERIFY(m_producer->pushInt(quint16(i), i));
+    const QList<Update> updates = drain();
+    QCOMPARE(updates.size(), 60);
+    for (int i = 0; i < 60; ++i) {
+        QCOMPARE(updates.at(i).id, quint16(i));
+        QCOMPARE(updates.at(i).value, qint64(i));
+    }
+    QCOMPARE(m_transport->dropped(), quint64(0));
+}
+
+void tst_ShmTransport::fullRingDropsRecords()
+{
+    for (quint32 i = 0; i < Capacity; ++i)
+        QVERIFY(m_producer->pushInt(quint16(i), i));
+    QCOMPARE(m_transport->usedBytes(), m_transport->capacityBytes());
+
+    QVERIFY(!m_producer->pushInt(999, 0));
+    QVERIFY(!m_producer->pushBool(999, true));
+    QCOMPARE(m_transport->dropped(), quint64(2));
+
+    // The records already queued are kept, and there is room again after
+    const QList<Update> updates = drain();
+    QCOMPARE(updates.size(), int(Capacity));
+    QCOMPARE(updates.last().id, quint16(Capacity - 1));
+    QVERIFY(m_producer->pushInt(999, 0));
+    QCOMPARE(drain().size(), 1);
+}
+
+void tst_ShmTransport::bogusTailIsClamped()
+{
+    Segment segment(m_name);
+    QVERIFY(segment.header());
+    ShmUpdateRingHeader *header = segment.header();
+
+    // A tail far past the head, as a broken producer might write it
+    const quint64 head = header->head.load();
+    header->tail.store(head + Capacity + 10);
+    QCOMPARE(drain().size(), int(Capacity));
+    QCOMPARE(m_transport->dropped(), quint64(10));
+    QCOMPARE(header->head.load(), head + Capacity + 10);
+    QCOMPARE(m_transport->usedBytes(), quint64(0));
+
+    // The ring keeps working from there
+    QVERIFY(m_producer->pushInt(5, 5));
+    const QList<Update> updates = drain();
+    QCOMPARE(updates.size(), 1);
+    QCOMPARE(updates.first().id, quint16(5));
+}
+
+QTEST_GUILESS_MAIN(tst_ShmTransport)
+#include "tst_shmtransport.moc"
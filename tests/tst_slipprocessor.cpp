@@ -0,0 +1,187 @@
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QTest>
+
+#include "slipprocessor.h"
+
+namespace {
+
+constexpr char End = char(0xC0);
+constexpr char Esc = char(0xDB);
+constexpr char EscEnd = char(0xDC);
+constexpr char EscEsc = char(0xDD);
+
+// Feeds data in chunks of chunkSize bytes and collects the decoded frames
+QList<QByteArray> decodeAll(SlipProcessor &slip, const QByteArray &data, qsizetype chunkSize = 0)
+{
+    QList<QByteArray> frames;
+    auto onFrame = [&frames](QByteArrayView frame) { frames.append(frame.toByteArray()); };
+    if (chunkSize <= 0) {
+        slip.decode(data, onFrame);
+        return frames;
+    }
+    for (qsizetype offset = 0; offset < data.size(); offset += chunkSize)
+        slip.decode(QByteArrayView(data).mid(offset, chunkSize), onFrame);
+    return frames;
+}
+
+} // namespace
+
+class tst_SlipProcessor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void appendSlipKeepsExistingContent();
+    void emptyPayloadIsFrameEnd();
+    void emptyFramesAreSkipped();
+    void severalFramesInOneChunk();
+    void escapeSplitAcrossChunks();
+    void unescapedFrameIsAViewIntoInput();
+    void escEndDropsFrame();
+    void invalidEscapeDropsRestOfFrame();
+    void invalidEscapesCountOncePerFrame();
+    void resetDropsPartialFrame();
+    void packetReceivedSignal();
+};
+
+void tst_SlipProcessor::roundTrip_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+
+    QByteArray allBytes;
+    for (int i = 0; i < 256; ++i)
+        allBytes.append(char(i));
+
+    QTest::newRow("plain") << QByteArray("hello");
+    QTest::newRow("end") << QByteArray("a\xC0" "b");
+    QTest::newRow("esc") << QByteArray("a\xDB" "b");
+    QTest::newRow("specials only") << QByteArray("\xC0\xDB\xDB\xC0");
+    QTest::newRow("leading and trailing") << QByteArray("\xC0" "middle\xDB");
+    QTest::newRow("all bytes") << allBytes;
+}
+
+void tst_SlipProcessor::roundTrip()
+{
+    QFETCH(QByteArray, payload);
+
+    const QByteArray encoded = SlipProcessor::encodeSlip(payload);
+    QCOMPARE(encoded.size(), SlipProcessor::encodedSize(payload));
+    QCOMPARE(encoded.back(), End);
+    QCOMPARE(encoded.count(End), 1);
+
+    for (qsizetype chunk : { qsizetype(0), qsizetype(1), qsizetype(3) }) {
+        SlipProcessor slip;
+        const QList<QByteArray> frames = decodeAll(slip, encoded, chunk);
+        QCOMPARE(frames.size(), 1);
+        QCOMPARE(frames.first(), payload);
+        QCOMPARE(slip.invalidEscapeCount(), quint64(0));
+    }
+}
+
+void tst_SlipProcessor::appendSlipKeepsExistingContent()
+{
+    QByteArray out("prefix");
+    SlipProcessor::appendSlip(QByteArray("a\xC0"), out);
+    QCOMPARE(out, QByteArray("prefix") + "a" + Esc + EscEnd + End);
+}
+
+void tst_SlipProcessor::emptyPayloadIsFrameEnd()
+{
+    // A default view has a null data()
+    const QByteArrayView empty;
+    QCOMPARE(SlipProcessor::encodedSize(empty), qsizetype(1));
+    QCOMPARE(SlipProcessor::encodeSlip(empty), QByteArray(1, End));
+
+    QByteArray out("prefix");
+    SlipProcessor::appendSlip(empty, out);
+    QCOMPARE(out, QByteArray("prefix") + End);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QCOMPARE(SlipProcessor::writeSlip(&buffer, empty), qint64(1));
+    QCOMPARE(buffer.data(), QByteArray(1, End));
+}
+
+void tst_SlipProcessor::emptyFramesAreSkipped()
+{
+    SlipProcessor slip;
+    QVERIFY(decodeAll(slip, QByteArray(4, End)).isEmpty());
+    QCOMPARE(slip.invalidEscapeCount(), quint64(0));
+}
+
+void tst_SlipProcessor::severalFramesInOneChunk()
+{
+    SlipProcessor slip;
+    const QByteArray stream = SlipProcessor::encodeSlip("one") + SlipProcessor::encodeSlip("t\xC0o")
+            + SlipProcessor::encodeSlip("three");
+    const QList<QByteArray> frames = decodeAll(slip, stream);
+    QCOMPARE(frames, (QList<QByteArray>{ "one", "t\xC0o", "three" }));
+}
+
+void tst_SlipProcessor::escapeSplitAcrossChunks()
+{
+    SlipProcessor slip;
+    QList<QByteArray> frames = decodeAll(slip, QByteArray("ab") + Esc);
+    QVERIFY(frames.isEmpty());
+    frames = decodeAll(slip, QByteArray(1, EscEsc) + "cd" + End);
+    QCOMPARE(frames, (QList<QByteArray>{ QByteArray("ab") + Esc + "cd" }));
+}
+
+void tst_SlipProcessor::unescapedFrameIsAViewIntoInput()
+{
+    SlipProcessor slip;
+    const QByteArray data = QByteArray("frame") + End;
+    const char *seen = nullptr;
+    slip.decode(data, [&seen](QByteArrayView frame) { seen = frame.data(); });
+    QVERIFY(seen == data.constData());
+}
+
+void tst_SlipProcessor::escEndDropsFrame()
+{
+    SlipProcessor slip;
+    const QByteArray data = QByteArray("bad") + Esc + End + "good" + End;
+    QCOMPARE(decodeAll(slip, data), (QList<QByteArray>{ "good" }));
+    QCOMPARE(slip.invalidEscapeCount(), quint64(1));
+}
+
+void tst_SlipProcessor::invalidEscapeDropsRestOfFrame()
+{
+    // The bytes after the bad escape belong to the corrupt frame too
+    for (qsizetype chunk : { qsizetype(0), qsizetype(1) }) {
+        SlipProcessor slip;
+        const QByteArray data = QByteArray("a") + Esc + char(0x01) + "rest" + End + "next" + End;
+        QCOMPARE(decodeAll(slip, data, chunk), (QList<QByteArray>{ "next" }));
+        QCOMPARE(slip.invalidEscapeCount(), quint64(1));
+    }
+}
+
+void tst_SlipProcessor::invalidEscapesCountOncePerFrame()
+{
+    SlipProcessor slip;
+    const QByteArray data = QByteArray(1, Esc) + char(0x01) + Esc + char(0x02) + Esc + End;
+    QVERIFY(decodeAll(slip, data).isEmpty());
+    QCOMPARE(slip.invalidEscapeCount(), quint64(1));
+}
+
+void tst_SlipProcessor::resetDropsPartialFrame()
+{
+    SlipProcessor slip;
+    QVERIFY(decodeAll(slip, QByteArray("stale") + Esc).isEmpty());
+    slip.reset();
+    QCOMPARE(decodeAll(slip, QByteArray("fresh") + End), (QList<QByteArray>{ "fresh" }));
+}
+
+void tst_SlipProcessor::packetReceivedSignal()
+{
+    SlipProcessor slip;
+    QSignalSpy spy(&slip, &SlipProcessor::packetReceived);
+    slip.onDataReceived(SlipProcessor::encodeSlip("x\xDBy"));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.first().first().toByteArray(), QByteArray("x\xDBy"));
+}
+
+QTEST_GUILESS_MAIN(tst_SlipProcessor)
+#include "tst_slipprocessor.moc"
@@ -0,0 +1,193 @@
+#include <QCborArray>
+#include <QTest>
+
+#include <algorithm>
+
+#include "bridgeharness.h"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property int a: 0
+    property int b: 0
+}
+)";
+
+// The IDs in a RESP_PROPERTY_CHANGE map, in ascending order
+QList<qint64> idsOf(const QCborMap &change)
+{
+    QList<qint64> ids;
+    for (const QCborValue &key : change.keys())
+        ids.append(key.toInteger());
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+} // namespace
+
+class tst_WatchCommands : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void addWatchExtendsSet();
+    void removeWatchShrinksSet();
+    void removeWatchAcceptsMaps();
+    void removeUnwatchedIsIgnored();
+    void addWatchReplacesFilter();
+    void malformedAddKeepsSet();
+    void malformedWatchClearsSet();
+    void outOfRangeIdsAreIgnored();
+
+private:
+    // Writes both properties in one command, so one flush carries both
+    void setBoth(int value);
+    QCborMap changeAfterSet(TestClient &client);
+
+    std::unique_ptr<BridgeHarness> m_harness;
+    int m_a = -1;
+    int m_b = -1;
+    int m_next = 0;
+};
+
+void tst_WatchCommands::init()
+{
+    m_harness = std::make_unique<BridgeHarness>(Scene);
+    QVERIFY(m_harness->isReady());
+    m_a = m_harness->propertyId("a");
+    m_b = m_harness->propertyId("b");
+}
+
+void tst_WatchCommands::cleanup()
+{
+    m_harness.reset();
+}
+
+void tst_WatchCommands::setBoth(int value)
+{
+    QCborMap map;
+    map.insert(m_a, value);
+    map.insert(m_b, value);
+    m_harness->bridge().processCommand(QByteArray(1, char(GenericQMLBridge::CMD_SET_PROPERTY)) + map.toCbor());
+}
+
+QCborMap tst_WatchCommands::changeAfterSet(TestClient &client)
+{
+    client.sync();
+    setBoth(++m_next);
+    return client.nextChange();
+}
+
+void tst_WatchCommands::addWatchExtendsSet()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a });
+    QCOMPARE(idsOf(changeAfterSet(*client)), QList<qint64>{ m_a });
+
+    client->send(GenericQMLBridge::CMD_ADD_WATCH, QCborArray{ m_b });
+    const QCborMap change = changeAfterSet(*client);
+    QCOMPARE(change.size(), 2);
+    QCOMPARE(change.value(m_a).toInteger(), qint64(m_next));
+    QCOMPARE(change.value(m_b).toInteger(), qint64(m_next));
+}
+
+void tst_WatchCommands::removeWatchShrinksSet()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a, m_b });
+    QCOMPARE(changeAfterSet(*client).size(), 2);
+
+    client->send(GenericQMLBridge::CMD_REMOVE_WATCH, QCborArray{ m_a });
+    QCOMPARE(idsOf(changeAfterSet(*client)), QList<qint64>{ m_b });
+}
+
+void tst_WatchCommands::removeWatchAcceptsMaps()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a, m_b });
+
+    // Options other than the ID are ignored
+    QCborMap entry;
+    entry.insert(QLatin1String("id"), m_b);
+    entry.insert(QLatin1String("deadband"), 1.0);
+    client->send(GenericQMLBridge::CMD_REMOVE_WATCH, QCborArray{ entry });
+    QCOMPARE(idsOf(changeAfterSet(*client)), QList<qint64>{ m_a });
+}
+
+void tst_WatchCommands::removeUnwatchedIsIgnored()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a });
+    client->send(GenericQMLBridge::CMD_REMOVE_WATCH, QCborArray{ m_b, 0xFFFF });
+    QCOMPARE(idsOf(changeAfterSet(*client)), QList<qint64>{ m_a });
+}
+
+void tst_WatchCommands::addWatchReplacesFilter()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    QCborMap entry;
+    entry.insert(QLatin1String("id"), m_a);
+    entry.insert(QLatin1String("deadband"), 100);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ entry });
+    QCOMPARE(changeAfterSet(*client).value(m_a).toInteger(), qint64(m_next));
+
+    // Within the deadband while it is set
+    setBoth(++m_next);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+
+    // A plain ID clears the filter
+    client->send(GenericQMLBridge::CMD_ADD_WATCH, QCborArray{ m_a });
+    QCOMPARE(changeAfterSet(*client).value(m_a).toInteger(), qint64(m_next));
+}
+
+void tst_WatchCommands::malformedAddKeepsSet()
+{
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a });
+    client->send(GenericQMLBridge::CMD_ADD_WATCH);
+    client->send(GenericQMLBridge::CMD_ADD_WATCH, m_b);
+    client->send(GenericQMLBridge::CMD_REMOVE_WATCH, QCborMap());
+    QCOMPARE(idsOf(changeAfterSet(*client)), QList<qint64>{ m_a });
+}
+
+void tst_WatchCommands::malformedWatchClearsSet()
+{
+    // Unlike ADD_WATCH, a WATCH_PROPERTY without a list replaces the set
+    // with an empty one
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a });
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY);
+    client->sync();
+    setBoth(++m_next);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+}
+
+void tst_WatchCommands::outOfRangeIdsAreIgnored()
+{
+    // Cast to 16 bits, these would land on a and b
+    auto client = m_harness->connectClient();
+    QVERIFY(client);
+    QCborMap entry;
+    entry.insert(QLatin1String("id"), m_b + 0x10000);
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, QCborArray{ m_a + 0x10000, entry, -1 });
+    client->send(GenericQMLBridge::CMD_ADD_WATCH, QCborArray{ qint64(m_a) - 0x10000 });
+    client->sync();
+    setBoth(++m_next);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+}
+
+QTEST_MAIN(tst_WatchCommands)
+#include "tst_watchcommands.moc"
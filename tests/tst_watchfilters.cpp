@@ -0,0 +1,183 @@
+#include <QCborArray>
+#include <QTest>
+
+#include "bridgeharness.h"
+
+namespace {
+
+const QByteArray Scene = R"(
+import QtQuick
+
+Item {
+    property real level: 0
+    property int count: 0
+}
+)";
+
+QCborMap filtered(int id, const char *option, const QCborValue &value)
+{
+    QCborMap entry;
+    entry.insert(QLatin1String("id"), id);
+    entry.insert(QLatin1String(option), value);
+    return entry;
+}
+
+} // namespace
+
+class tst_WatchFilters : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void deadband();
+    void relativeDeadband();
+    void onChange();
+    void minIntervalSendsLatest();
+    void filtersArePerClient();
+    void rewatchKeepsLastSent();
+
+private:
+    // Writes through the bridge directly; watchers see it on the next flush
+    void set(int id, const QCborValue &value);
+    std::unique_ptr<TestClient> watch(const QCborArray &entries);
+
+    std::unique_ptr<BridgeHarness> m_harness;
+    int m_level = -1;
+    int m_count = -1;
+};
+
+void tst_WatchFilters::init()
+{
+    m_harness = std::make_unique<BridgeHarness>(Scene);
+    QVERIFY(m_harness->isReady());
+    m_level = m_harness->propertyId("level");
+    m_count = m_harness->propertyId("count");
+}
+
+void tst_WatchFilters::cleanup()
+{
+    m_harness.reset();
+}
+
+void tst_WatchFilters::set(int id, const QCborValue &value)
+{
+    QCborMap map;
+    map.insert(id, value);
+    m_harness->bridge().processCommand(QByteArray(1, char(GenericQMLBridge::CMD_SET_PROPERTY)) + map.toCbor());
+}
+
+std::unique_ptr<TestClient> tst_WatchFilters::watch(const QCborArray &entries)
+{
+    auto client = m_harness->connectClient();
+    if (client) {
+        client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, entries);
+        client->sync();
+    }
+    return client;
+}
+
+void tst_WatchFilters::deadband()
+{
+    auto client = watch({ filtered(m_level, "deadband", 0.5) });
+    QVERIFY(client);
+
+    // The first change always goes out
+    set(m_level, 1.0);
+    QCOMPARE(client->nextChange().value(m_level).toDouble(), 1.0);
+
+    set(m_level, 1.2);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+
+    // Measured against the last value sent, not the last one seen
+    set(m_level, 1.6);
+    QCOMPARE(client->nextChange().value(m_level).toDouble(), 1.6);
+}
+
+void tst_WatchFilters::relativeDeadband()
+{
+    auto client = watch({ filtered(m_level, "deadband_rel", 0.1) });
+    QVERIFY(client);
+
+    set(m_level, 10.0);
+    QCOMPARE(client->nextChange().value(m_level).toDouble(), 10.0);
+
+    set(m_level, 10.5);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+
+    set(m_level, 11.5);
+    QCOMPARE(client->nextChange().value(m_level).toDouble(), 11.5);
+}
+
+void tst_WatchFilters::onChange()
+{
+    auto client = watch({ filtered(m_count, "on_change", true) });
+    auto plain = watch({ m_count });
+    QVERIFY(client);
+    QVERIFY(plain);
+
+    set(m_count, 1);
+    QCOMPARE(client->nextChange().value(m_count).toInteger(), qint64(1));
+    QCOMPARE(plain->nextChange().value(m_count).toInteger(), qint64(1));
+
+    // Both writes land in one flush, which only carries the latest value:
+    // the same one the filtered client was sent last
+    set(m_count, 2);
+    set(m_count, 1);
+    QCOMPARE(plain->nextChange().value(m_count).toInteger(), qint64(1));
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+}
+
+void tst_WatchFilters::minIntervalSendsLatest()
+{
+    auto client = watch({ filtered(m_count, "min_interval", 300) });
+    QVERIFY(client);
+
+    set(m_count, 1);
+    QCOMPARE(client->nextChange().value(m_count).toInteger(), qint64(1));
+
+    // Held back, not dropped: the latest value follows once the interval ends
+    set(m_count, 2);
+    QTest::qWait(20);
+    set(m_count, 3);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 100));
+    QCOMPARE(client->nextChange(2000).value(m_count).toInteger(), qint64(3));
+}
+
+void tst_WatchFilters::filtersArePerClient()
+{
+    auto filteredClient = watch({ filtered(m_level, "deadband", 5.0) });
+    auto plain = watch({ m_level });
+    QVERIFY(filteredClient);
+    QVERIFY(plain);
+
+    set(m_level, 1.0);
+    QCOMPARE(filteredClient->nextChange().value(m_level).toDouble(), 1.0);
+    QCOMPARE(plain->nextChange().value(m_level).toDouble(), 1.0);
+
+    set(m_level, 2.0);
+    QCOMPARE(plain->nextChange().value(m_level).toDouble(), 2.0);
+    QVERIFY(!filteredClient->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+}
+
+void tst_WatchFilters::rewatchKeepsLastSent()
+{
+    const QCborArray entries = { filtered(m_level, "deadband", 0.5) };
+    auto client = watch(entries);
+    QVERIFY(client);
+
+    set(m_level, 1.0);
+    QCOMPARE(client->nextChange().value(m_level).toDouble(), 1.0);
+
+    // Sending the same watch again is not a new watch, so the next change
+    // is still compared against 1.0
+    client->send(GenericQMLBridge::CMD_WATCH_PROPERTY, entries);
+    client->sync();
+    set(m_level, 1.2);
+    QVERIFY(!client->receives(GenericQMLBridge::RESP_PROPERTY_CHANGE, 150));
+}
+
+QTEST_MAIN(tst_WatchFilters)
+#include "tst_watchfilters.moc"
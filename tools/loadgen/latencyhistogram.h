@@ -0,0 +1,106 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+#include <array>
+
+// Log-linear histogram of nanosecond samples: 64 linear sub-buckets per
+// power of two, so any reported value is within 1.6% of the sample.
+class LatencyHistogram
+{
+public:
+    void record(qint64 ns)
+    {
+        const quint64 value = ns > 0 ? quint64(ns) : 0;
+        ++m_counts[indexFor(value)];
+        ++m_count;
+        m_sum += value;
+        m_min = qMin(m_min, value);
+        m_max = qMax(m_max, value);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < m_counts.size(); ++i)
+            m_counts[i] += other.m_counts[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        m_min = qMin(m_min, other.m_min);
+        m_max = qMax(m_max, other.m_max);
+    }
+
+    quint64 count() const { return m_count; }
+    quint64 min() const { return m_count ? m_min : 0; }
+    quint64 max() const { return m_max; }
+    double mean() const { return m_count ? double(m_sum) / double(m_count) : 0.0; }
+
+    // Upper bound of the bucket holding the p-th percentile (0..100)
+    quint64 percentile(double p) const
+    {
+        if (!m_count)
+            return 0;
+        const quint64 rank = qMax<quint64>(1, quint64(double(m_count) * p / 100.0 + 0.5));
+        quint64 seen = 0;
+        for (size_t i = 0; i < m_counts.size(); ++i) {
+            seen += m_counts[i];
+            if (seen >= rank)
+                return qMin(upperBound(int(i)), m_max);
+        }
+        return m_max;
+    }
+
+    // Summary in microseconds, plus the non-empty buckets as [upper_us, count]
+    QJsonObject toJson() const
+    {
+        QJsonArray buckets;
+        for (size_t i = 0; i < m_counts.size(); ++i) {
+            if (m_counts[i])
+                buckets.append(QJsonArray{ double(upperBound(int(i))) / 1000.0, double(m_counts[i]) });
+        }
+        return {
+            { QStringLiteral("count"), double(m_count) },
+            { QStringLiteral("min_us"), double(min()) / 1000.0 },
+            { QStringLiteral("mean_us"), mean() / 1000.0 },
+            { QStringLiteral("p50_us"), double(percentile(50)) / 1000.0 },
+            { QStringLiteral("p90_us"), double(percentile(90)) / 1000.0 },
+            { QStringLiteral("p99_us"), double(percentile(99)) / 1000.0 },
+            { QStringLiteral("p999_us"), double(percentile(99.9)) / 1000.0 },
+            { QStringLiteral("max_us"), double(m_max) / 1000.0 },
+            { QStringLiteral("buckets"), buckets },
+        };
+    }
+
+private:
+    static constexpr int SubBucketBits = 6;
+    static constexpr int SubBuckets = 1 << SubBucketBits;
+
+    static int indexFor(quint64 value)
+    {
+        if (value < SubBuckets)
+            return int(value);
+        const int exponent = 63 - int(qCountLeadingZeroBits(value));
+        const int shift = exponent - SubBucketBits;
+        return SubBuckets + shift * SubBuckets + int((value >> shift) - SubBuckets);
+    }
+
+    static quint64 upperBound(int index)
+    {
+        if (index < SubBuckets)
+            return quint64(index);
+        const int shift = (index - SubBuckets) / SubBuckets;
+        const quint64 sub = quint64((index - SubBuckets) % SubBuckets + SubBuckets);
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::array<quint64, SubBuckets + (64 - SubBucketBits) * SubBuckets> m_counts {};
+    quint64 m_count = 0;
+    quint64 m_sum = 0;
+    quint64 m_min = ~quint64(0);
+    quint64 m_max = 0;
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "loadclient.h"
+
+#include "cborvaluereader.hpp"
+
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QSocketNotifier>
+#include <QTcpSocket>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+// Same codes as GenericQMLBridge::ProtocolCommand/ProtocolResponse
+enum : quint8 {
+    CMD_GET_PROPERTY_LIST  = 0x01,
+    CMD_SET_PROPERTY       = 0x02,
+    CMD_WATCH_PROPERTY     = 0x20,
+    RESP_GET_PROPERTY_LIST = 0x81,
+    RESP_PROPERTY_CHANGE   = 0x82,
+};
+
+LoadClient::LoadClient(const QElapsedTimer *clock, LatencyHistogram *histogram,
+                       const QStringList &targets, QObject *parent)
+    : QObject(parent)
+    , m_clock(clock)
+    , m_histogram(histogram)
+    , m_targetNames(targets)
+{
+    // Keep asking until the server answers; it may not be up yet
+    m_retryTimer.setInterval(1000);
+    connect(&m_retryTimer, &QTimer::timeout, this, &LoadClient::requestPropertyList);
+}
+
+LoadClient::~LoadClient()
+{
+#ifdef Q_OS_UNIX
+    if (m_ptyFd >= 0)
+        ::close(m_ptyFd);
+    if (m_ptySlaveFd >= 0)
+        ::close(m_ptySlaveFd);
+#endif
+}
+
+void LoadClient::connectToHost(const QString &host, quint16 port)
+{
+    m_socket = new QTcpSocket(this);
+    connect(m_socket, &QTcpSocket::connected, this, [this]() {
+        m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        start();
+    });
+    connect(m_socket, &QTcpSocket::readyRead, this, [this]() {
+        const qint64 available = m_socket->bytesAvailable();
+        m_readBuffer.resize(available);
+        const qint64 n = m_socket->read(m_readBuffer.data(), available);
+        if (n > 0)
+            onBytes(QByteArrayView(m_readBuffer.constData(), n));
+    });
+    connect(m_socket, &QAbstractSocket::errorOccurred, this, [this]() {
+        emit failed(m_socket->errorString());
+    });
+    m_socket->connectToHost(host, port);
+}
+
+bool LoadClient::openPty(QString *slavePath)
+{
+#ifdef Q_OS_UNIX
+    m_ptyFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (m_ptyFd < 0 || ::grantpt(m_ptyFd) < 0 || ::unlockpt(m_ptyFd) < 0) {
+        emit failed(QStringLiteral("Could not allocate a pty: %1").arg(qt_error_string(errno)));
+        return false;
+    }
+    *slavePath = QString::fromLocal8Bit(::ptsname(m_ptyFd));
+
+    // Holding the slave open keeps reads on the master from failing with
+    // EIO until the server opens it
+    m_ptySlaveFd = ::open(::ptsname(m_ptyFd), O_RDWR | O_NOCTTY);
+    if (m_ptySlaveFd >= 0) {
+        termios tio;
+        if (::tcgetattr(m_ptySlaveFd, &tio) == 0) {
+            ::cfmakeraw(&tio);
+            ::tcsetattr(m_ptySlaveFd, TCSANOW, &tio);
+        }
+    }
+    ::fcntl(m_ptyFd, F_SETFL, ::fcntl(m_ptyFd, F_GETFL) | O_NONBLOCK);
+
+    m_readNotifier = new QSocketNotifier(m_ptyFd, QSocketNotifier::Read, this);
+    connect(m_readNotifier, &QSocketNotifier::activated, this, &LoadClient::readPty);
+    m_writeNotifier = new QSocketNotifier(m_ptyFd, QSocketNotifier::Write, this);
+    m_writeNotifier->setEnabled(false);
+    connect(m_writeNotifier, &QSocketNotifier::activated, this, &LoadClient::flushPty);
+
+    start();
+    return true;
+#else
+    Q_UNUSED(slavePath);
+    emit failed(QStringLiteral("pty mode is only available on Unix"));
+    return false;
+#endif
+}
+
+void LoadClient::start()
+{
+    requestPropertyList();
+    m_retryTimer.start();
+}
+
+void LoadClient::requestPropertyList()
+{
+    writeFrame(QByteArray(1, char(CMD_GET_PROPERTY_LIST)));
+}
+
+quint64 LoadClient::pending() const
+{
+    quint64 count = 0;
+    for (const auto &sets : m_pending)
+        count += sets.size();
+    return count;
+}
+
+void LoadClient::sendSet(qint64 value)
+{
+    if (!m_ready || m_targetIds.isEmpty())
+        return;
+
+    const quint16 id = m_targetIds.at(m_nextTarget);
+    m_nextTarget = (m_nextTarget + 1) % m_targetIds.size();
+
+    QByteArray packet(1, char(CMD_SET_PROPERTY));
+    {
+        QCborStreamWriter writer(&packet);
+        writer.startMap(1);
+        writer.append(quint64(id));
+        writer.append(value);
+        writer.endMap();
+    }
+    m_pending[id].push_back({ value, m_clock->nsecsElapsed() });
+    writeFrame(packet);
+    ++m_stats.sets;
+}
+
+void LoadClient::writeFrame(const QByteArray &packet)
+{
+    m_encodeBuffer.resize(0);
+    SlipProcessor::appendSlip(packet, m_encodeBuffer);
+    writeRaw(m_encodeBuffer.constData(), m_encodeBuffer.size());
+}
+
+void LoadClient::writeRaw(const char *data, qsizetype size)
+{
+    m_stats.bytesSent += size;
+    if (m_socket) {
+        m_socket->write(data, size);
+        return;
+    }
+#ifdef Q_OS_UNIX
+    if (m_ptyPending.isEmpty()) {
+        const ssize_t n = ::write(m_ptyFd, data, size_t(size));
+        if (n == size)
+            return;
+        if (n > 0) {
+            data += n;
+            size -= n;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return;
+        }
+    }
+    m_ptyPending.append(data, size);
+    m_writeNotifier->setEnabled(true);
+#endif
+}
+
+void LoadClient::flushPty()
+{
+#ifdef Q_OS_UNIX
+    const ssize_t n = ::write(m_ptyFd, m_ptyPending.constData(), size_t(m_ptyPending.size()));
+    if (n > 0)
+        m_ptyPending.remove(0, n);
+    if (m_ptyPending.isEmpty())
+        m_writeNotifier->setEnabled(false);
+#endif
+}
+
+void LoadClient::readPty()
+{
+#ifdef Q_OS_UNIX
+    m_readBuffer.resize(64 * 1024);
+    const ssize_t n = ::read(m_ptyFd, m_readBuffer.data(), size_t(m_readBuffer.size()));
+    if (n > 0)
+        onBytes(QByteArrayView(m_readBuffer.constData(), n));
+#endif
+}
+
+void LoadClient::onBytes(QByteArrayView data)
+{
+    m_stats.bytesReceived += data.size();
+    m_slip.decode(data, [this](QByteArrayView frame) {
+        handleFrame(frame);
+    });
+}
+
+void LoadClient::handleFrame(QByteArrayView frame)
+{
+    if (frame.isEmpty())
+        return;
+    const QByteArrayView payload = frame.sliced(1);
+    switch (static_cast<quint8>(frame.front())) {
+    case RESP_GET_PROPERTY_LIST:
+        handlePropertyList(payload);
+        break;
+    case RESP_PROPERTY_CHANGE:
+        handlePropertyChange(payload);
+        break;
+    default:
+        break;
+    }
+}
+
+void LoadClient::handlePropertyList(QByteArrayView payload)
+{
+    if (m_ready)
+        return;
+    m_retryTimer.stop();
+
+    const QCborMap properties = QCborValue::fromCbor(payload.toByteArray()).toMap();
+    QCborArray watch;
+    for (const QString &name : std::as_const(m_targetNames)) {
+        const QCborValue entry = properties.value(name);
+        if (!entry.isMap()) {
+            emit failed(QStringLiteral("Unknown property: %1").arg(name));
+            return;
+        }
+        const quint16 id = quint16(entry.toMap().value(QStringLiteral("id")).toInteger());
+        m_targetIds.append(id);
+        watch.append(qint64(id));
+    }
+
+    QByteArray packet(1, char(CMD_WATCH_PROPERTY));
+    packet += QCborValue(watch).toCbor();
+    writeFrame(packet);
+
+    m_ready = true;
+    emit ready();
+}
+
+void LoadClient::handlePropertyChange(QByteArrayView payload)
+{
+    ++m_stats.notifications;
+    const qint64 now = m_clock->nsecsElapsed();
+
+    QCborStreamReader reader(payload);
+    if (!reader.isMap() || !reader.enterContainer())
+        return;
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        qint64 id = -1;
+        QString name;
+        if (!CborValueReader::readKey(reader, &id, &name) || id < 0) {
+            reader.next();
+            continue;
+        }
+        const qint64 value = CborValueReader::readValue(reader).toLongLong();
+
+        auto it = m_pending.find(quint16(id));
+        if (it == m_pending.end())
+            continue;
+        // Values are unique and sent in order: anything older than the
+        // notified value was overwritten before it went out
+        std::deque<PendingSet> &sets = it.value();
+        while (!sets.empty() && sets.front().value < value) {
+            sets.pop_front();
+            ++m_stats.superseded;
+        }
+        if (!sets.empty() && sets.front().value == value) {
+            m_histogram->record(now - sets.front().sentAt);
+            sets.pop_front();
+            ++m_stats.matched;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef LOADCLIENT_H
+#define LOADCLIENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+
+#include <deque>
+
+#include "slipprocessor.h"
+#include "latencyhistogram.h"
+
+class QSocketNotifier;
+class QTcpSocket;
+
+// One simulated client session, over TCP or the master side of a pty.
+// Fetches the property list, watches its target properties, then sends
+// SET_PROPERTY on demand and times how long each value takes to come back
+// as RESP_PROPERTY_CHANGE.
+class LoadClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 sets = 0;          // SET_PROPERTY frames sent
+        quint64 notifications = 0; // RESP_PROPERTY_CHANGE frames received
+        quint64 matched = 0;       // sets whose own value was notified
+        quint64 superseded = 0;    // sets coalesced away by a later value
+        quint64 bytesSent = 0;
+        quint64 bytesReceived = 0;
+    };
+
+    // Latencies are recorded into histogram, which may be shared
+    LoadClient(const QElapsedTimer *clock, LatencyHistogram *histogram,
+               const QStringList &targets, QObject *parent = nullptr);
+    ~LoadClient();
+
+    void connectToHost(const QString &host, quint16 port);
+    // Opens a pty pair; the server is started on *slavePath as its serial port
+    bool openPty(QString *slavePath);
+
+    bool isReady() const { return m_ready; }
+    // Sets the next target property to value, which must be unique across
+    // all clients so notifications can be matched to their set
+    void sendSet(qint64 value);
+
+    const Stats &stats() const { return m_stats; }
+    quint64 pending() const;
+
+signals:
+    void ready();
+    void failed(const QString &error);
+
+private:
+    struct PendingSet {
+        qint64 value;
+        qint64 sentAt;
+    };
+
+    void start();
+    void requestPropertyList();
+    void writeFrame(const QByteArray &packet);
+    void writeRaw(const char *data, qsizetype size);
+    void flushPty();
+    void readPty();
+    void onBytes(QByteArrayView data);
+    void handleFrame(QByteArrayView frame);
+    void handlePropertyList(QByteArrayView payload);
+    void handlePropertyChange(QByteArrayView payload);
+
+    const QElapsedTimer *m_clock;
+    LatencyHistogram *m_histogram;
+    QStringList m_targetNames;
+    QList<quint16> m_targetIds;
+    qsizetype m_nextTarget = 0;
+    bool m_ready = false;
+
+    QTcpSocket *m_socket = nullptr;
+    int m_ptyFd = -1;
+    int m_ptySlaveFd = -1;
+    QSocketNotifier *m_readNotifier = nullptr;
+    QSocketNotifier *m_writeNotifier = nullptr;
+    QByteArray m_ptyPending;
+    QTimer m_retryTimer;
+
+    SlipProcessor m_slip;
+    QByteArray m_readBuffer;
+    QByteArray m_encodeBuffer;
+    QHash<quint16, std::deque<PendingSet>> m_pending;
+    Stats m_stats;
+};
+
+#endif
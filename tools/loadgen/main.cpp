@@ -0,0 +1,177 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QTimer>
+
+#include "latencyhistogram.h"
+#include "loadclient.h"
+
+// Drives SET_PROPERTY traffic against a running qml-remoteserver and
+// reports set-to-notify latency and throughput.
+//
+//   qml-remoteserver-loadgen --tcp 8080 --clients 50 --rate 2000 -P temperature -P pressure
+//   qml-remoteserver-loadgen --pty --rate 200 -P setpoint
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Load generator and latency harness for qml-remoteserver");
+    parser.addHelpOption();
+    parser.addOption({{"H", "host"}, "Server host", "host", "127.0.0.1"});
+    parser.addOption({{"t", "tcp"}, "Server TCP port", "tcpport"});
+    parser.addOption({"pty", "Drive the server through a pty pair instead of TCP; start it with --port on the printed path"});
+    parser.addOption({{"c", "clients"}, "Concurrent TCP sessions", "count", "1"});
+    parser.addOption({{"r", "rate"}, "Total SET_PROPERTY frames per second, across all sessions", "rate", "100"});
+    parser.addOption({{"d", "duration"}, "Measurement time in seconds", "seconds", "10"});
+    parser.addOption({{"P", "property"}, "Numeric property to drive; repeat or comma-separate", "name"});
+    parser.addOption({{"j", "json"}, "Write the results as JSON to this file", "file"});
+    parser.process(app);
+
+    QStringList properties;
+    for (const QString &value : parser.values("property"))
+        properties += value.split(',', Qt::SkipEmptyParts);
+    if (properties.isEmpty()) {
+        qCritical() << "Error: name at least one numeric property with --property";
+        return 1;
+    }
+
+    const bool usePty = parser.isSet("pty");
+    if (usePty == parser.isSet("tcp")) {
+        qCritical() << "Error: use either --tcp <port> or --pty";
+        return 1;
+    }
+    const int clientCount = usePty ? 1 : qMax(1, parser.value("clients").toInt());
+    const double rate = qMax(1.0, parser.value("rate").toDouble());
+    const int duration = qMax(1, parser.value("duration").toInt());
+
+    QElapsedTimer clock;
+    clock.start();
+    LatencyHistogram histogram;
+
+    // Spread the properties over the sessions; with more sessions than
+    // properties, sessions share them and their sets coalesce
+    QList<LoadClient *> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        QStringList targets;
+        for (qsizetype p = i % properties.size(); p < properties.size(); p += clientCount)
+            targets << properties.at(p);
+        auto client = new LoadClient(&clock, &histogram, targets, &app);
+        QObject::connect(client, &LoadClient::failed, &app, [i](const QString &error) {
+            qCritical() << "Session" << i << "failed:" << error;
+            QCoreApplication::exit(1);
+        });
+        clients << client;
+    }
+
+    if (usePty) {
+        QString slavePath;
+        if (!clients.first()->openPty(&slavePath))
+            return 1;
+        out << "Serial side of the pty: " << slavePath << Qt::endl;
+    } else {
+        const QString host = parser.value("host");
+        const quint16 port = quint16(parser.value("tcp").toUInt());
+        for (LoadClient *client : std::as_const(clients))
+            client->connectToHost(host, port);
+    }
+
+    // Token bucket on a 1 ms tick: send whatever the elapsed time allows,
+    // round-robin over the sessions
+    QTimer tick;
+    tick.setTimerType(Qt::PreciseTimer);
+    tick.setInterval(1);
+    qint64 startedAt = 0;
+    qint64 nextValue = 1;
+    qint64 sent = 0;
+    qsizetype nextClient = 0;
+    QObject::connect(&tick, &QTimer::timeout, &app, [&]() {
+        const double elapsed = double(clock.nsecsElapsed() - startedAt) / 1e9;
+        const qint64 due = qint64(elapsed * rate);
+        // Do not try to catch up on more than 10 ms of backlog at once
+        sent = qMax(sent, due - qint64(rate / 100.0) - 1);
+        while (sent < due) {
+            clients.at(nextClient)->sendSet(nextValue++);
+            nextClient = (nextClient + 1) % clients.size();
+            ++sent;
+        }
+    });
+
+    auto report = [&]() {
+        LoadClient::Stats total;
+        quint64 pending = 0;
+        for (const LoadClient *client : std::as_const(clients)) {
+            const LoadClient::Stats &stats = client->stats();
+            total.sets += stats.sets;
+            total.notifications += stats.notifications;
+            total.matched += stats.matched;
+            total.superseded += stats.superseded;
+            total.bytesSent += stats.bytesSent;
+            total.bytesReceived += stats.bytesReceived;
+            pending += client->pending();
+        }
+
+        const double seconds = double(duration);
+        out << "Sessions: " << clientCount << ", target rate: " << rate << "/s, duration: " << duration << " s" << Qt::endl;
+        out << "Sets sent: " << total.sets << " (" << double(total.sets) / seconds << "/s)" << Qt::endl;
+        out << "Notifications: " << total.notifications << " (" << double(total.notifications) / seconds << "/s)" << Qt::endl;
+        out << "Matched: " << total.matched << ", coalesced: " << total.superseded << ", lost: " << pending << Qt::endl;
+        out << "Latency (us): p50 " << double(histogram.percentile(50)) / 1000.0
+            << "  p99 " << double(histogram.percentile(99)) / 1000.0
+            << "  p999 " << double(histogram.percentile(99.9)) / 1000.0
+            << "  max " << double(histogram.max()) / 1000.0 << Qt::endl;
+
+        if (parser.isSet("json")) {
+            const QJsonObject result {
+                { "transport", usePty ? "pty" : "tcp" },
+                { "sessions", clientCount },
+                { "properties", QJsonArray::fromStringList(properties) },
+                { "target_rate", rate },
+                { "duration_s", duration },
+                { "sets", double(total.sets) },
+                { "notifications", double(total.notifications) },
+                { "matched", double(total.matched) },
+                { "coalesced", double(total.superseded) },
+                { "lost", double(pending) },
+                { "sets_per_s", double(total.sets) / seconds },
+                { "notifications_per_s", double(total.notifications) / seconds },
+                { "bytes_sent", double(total.bytesSent) },
+                { "bytes_received", double(total.bytesReceived) },
+                { "latency", histogram.toJson() },
+            };
+            QFile file(parser.value("json"));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qCritical() << "Error: cannot write" << file.fileName();
+                return;
+            }
+            file.write(QJsonDocument(result).toJson());
+        }
+    };
+
+    // Start once every session has its property IDs, stop after the
+    // measurement time plus one second for the last notifications
+    int readyCount = 0;
+    for (LoadClient *client : std::as_const(clients)) {
+        QObject::connect(client, &LoadClient::ready, &app, [&]() {
+            if (++readyCount < clientCount)
+                return;
+            out << "All " << clientCount << " sessions ready, running for " << duration << " s" << Qt::endl;
+            startedAt = clock.nsecsElapsed();
+            tick.start();
+            QTimer::singleShot(duration * 1000, &app, [&]() {
+                tick.stop();
+                QTimer::singleShot(1000, &app, [&]() {
+                    report();
+                    QCoreApplication::quit();
+                });
+            });
+        });
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,253 @@
+#include "transport.h"
+
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <utility>
+
+// How long shutdown waits for each client to take its pending output
+static constexpr int DisconnectTimeoutMs = 1000;
+
+Transport::Transport(Kind kind, const QString &name, QObject *parent)
+    : QObject(parent)
+    , m_kind(kind)
+    , m_name(name)
+{
+}
+
+SerialTransport::SerialTransport(const QString &portName, int baudRate, QObject *parent)
+    : Transport(Serial, QStringLiteral("serial:%1").arg(portName), parent)
+    , m_portName(portName)
+    , m_baudRate(baudRate)
+{
+}
+
+bool SerialTransport::open()
+{
+    if (m_port)
+        return true;
+
+    auto port = new QSerialPort(this);
+    port->setPortName(m_portName);
+    port->setBaudRate(m_baudRate);
+    if (!port->open(QIODevice::ReadWrite)) {
+        emit errorOccurred(tr("Failed to open serial port %1: %2").arg(m_portName, port->errorString()));
+        delete port;
+        return false;
+    }
+
+    m_port = port;
+    connect(m_port, &QSerialPort::errorOccurred, this, &SerialTransport::handleError);
+    emit deviceOpened(m_port);
+    return true;
+}
+
+void SerialTransport::close()
+{
+    if (!m_port)
+        return;
+
+    QSerialPort *port = std::exchange(m_port, nullptr);
+    port->disconnect(this);
+    emit deviceClosed(port);
+    port->close();
+    port->deleteLater();
+    qDebug() << "Serial port closed:" << m_portName;
+}
+
+void SerialTransport::check()
+{
+    if (!m_port)
+        open();
+}
+
+void SerialTransport::handleError(QSerialPort::SerialPortError error)
+{
+    if (error == QSerialPort::NoError) return;
+
+    emit errorOccurred(tr("Serial Error on %1: %2").arg(m_portName, m_port->errorString()));
+
+    // A timeout only ends a blocking wait. Anything else leaves the port
+    // unusable: an unplugged device shows up as ResourceError, ReadError or
+    // another code depending on the platform. Closing reports the session
+    // as lost, and check() reopens the port once it can.
+    if (error == QSerialPort::TimeoutError)
+        return;
+    close();
+}
+
+void ServerTransport::addClient(QIODevice *client)
+{
+    m_clients.insert(client);
+    emit deviceOpened(client);
+}
+
+void ServerTransport::removeClient(QIODevice *client)
+{
+    if (!m_clients.remove(client))
+        return;
+
+    client->disconnect(this);
+    emit deviceClosed(client);
+    client->deleteLater();
+}
+
+void ServerTransport::close()
+{
+    closeServer();
+
+    const QSet<QIODevice *> clients = std::exchange(m_clients, {});
+    for (QIODevice *client : clients) {
+        client->disconnect(this);
+        emit deviceClosed(client);
+        closeClient(client);
+        client->deleteLater();
+    }
+}
+
+void ServerTransport::check()
+{
+    const QSet<QIODevice *> clients = m_clients;
+    for (QIODevice *client : clients) {
+        if (!isConnected(client))
+            removeClient(client);
+    }
+}
+
+void ServerTransport::disconnectDevice(QIODevice *device)
+{
+    // The device may already be gone by the time a queued call lands here
+    if (m_clients.contains(device))
+        abortClient(device);
+}
+
+TcpTransport::TcpTransport(quint16 port, QObject *parent)
+    : ServerTransport(Tcp, QStringLiteral("tcp:%1").arg(port), parent)
+    , m_port(port)
+    , m_server(new QTcpServer(this))
+{
+    connect(m_server, &QTcpServer::newConnection, this, &TcpTransport::handleNewConnection);
+}
+
+bool TcpTransport::open()
+{
+    if (m_server->isListening())
+        return true;
+
+    if (!m_server->listen(QHostAddress::Any, m_port)) {
+        emit errorOccurred(tr("Error starting TCP server on port %1: %2").arg(m_port).arg(m_server->errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool TcpTransport::isOpen() const
+{
+    return m_server->isListening();
+}
+
+void TcpTransport::handleNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            removeClient(socket);
+        });
+        connect(socket, &QAbstractSocket::errorOccurred, this, [this, socket](QAbstractSocket::SocketError error) {
+            emit errorOccurred(tr("TCP Error: %1").arg(socket->errorString()));
+            if (error != QAbstractSocket::RemoteHostClosedError)
+                socket->disconnectFromHost();
+        });
+        addClient(socket);
+    }
+}
+
+bool TcpTransport::isConnected(QIODevice *client) const
+{
+    return static_cast<QTcpSocket *>(client)->state() == QAbstractSocket::ConnectedState;
+}
+
+void TcpTransport::closeServer()
+{
+    m_server->close();
+}
+
+void TcpTransport::closeClient(QIODevice *client)
+{
+    auto socket = static_cast<QTcpSocket *>(client);
+    socket->disconnectFromHost();
+    if (socket->state() != QAbstractSocket::UnconnectedState)
+        socket->waitForDisconnected(DisconnectTimeoutMs);
+}
+
+void TcpTransport::abortClient(QIODevice *client)
+{
+    static_cast<QTcpSocket *>(client)->abort();
+}
+
+LocalTransport::LocalTransport(const QString &serverName, QObject *parent)
+    : ServerTransport(Local, QStringLiteral("local:%1").arg(serverName), parent)
+    , m_serverName(serverName)
+    , m_server(new QLocalServer(this))
+{
+    connect(m_server, &QLocalServer::newConnection, this, &LocalTransport::handleNewConnection);
+}
+
+bool LocalTransport::open()
+{
+    if (m_server->isListening())
+        return true;
+
+    // A previous instance that crashed leaves its socket file behind
+    QLocalServer::removeServer(m_serverName);
+    if (!m_server->listen(m_serverName)) {
+        emit errorOccurred(tr("Error starting local server %1: %2").arg(m_serverName, m_server->errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool LocalTransport::isOpen() const
+{
+    return m_server->isListening();
+}
+
+void LocalTransport::handleNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            removeClient(socket);
+        });
+        connect(socket, &QLocalSocket::errorOccurred, this, [this, socket](QLocalSocket::LocalSocketError error) {
+            emit errorOccurred(tr("Local socket error: %1").arg(socket->errorString()));
+            if (error != QLocalSocket::PeerClosedError)
+                socket->disconnectFromServer();
+        });
+        addClient(socket);
+    }
+}
+
+bool LocalTransport::isConnected(QIODevice *client) const
+{
+    return static_cast<QLocalSocket *>(client)->state() == QLocalSocket::ConnectedState;
+}
+
+void LocalTransport::closeServer()
+{
+    m_server->close();
+}
+
+void LocalTransport::closeClient(QIODevice *client)
+{
+    auto socket = static_cast<QLocalSocket *>(client);
+    socket->disconnectFromServer();
+    if (socket->state() != QLocalSocket::UnconnectedState)
+        socket->waitForDisconnected(DisconnectTimeoutMs);
+}
+
+void LocalTransport::abortClient(QIODevice *client)
+{
+    static_cast<QLocalSocket *>(client)->abort();
+}
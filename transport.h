@@ -0,0 +1,153 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QSet>
+#include <QSerialPort>
+#include <QString>
+
+#include "metrics.h"
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+// One endpoint the server talks through: a serial port, or a listening
+// socket and the clients connected to it. A transport only manages its
+// devices; the I/O worker turns every opened device into a session with
+// its own SLIP decoder.
+class Transport : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind {
+        Serial,
+        Tcp,
+        Local
+    };
+    Q_ENUM(Kind)
+
+    Transport(Kind kind, const QString &name, QObject *parent = nullptr);
+
+    Kind kind() const { return m_kind; }
+    // Unique label such as "serial:/dev/ttyUSB0" or "tcp:8080"
+    QString name() const { return m_name; }
+    TransportCounters &counters() { return m_counters; }
+    const TransportCounters &counters() const { return m_counters; }
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    // Called periodically: reopen lost ports, drop dead clients
+    virtual void check() {}
+    // Drops one client without waiting for pending output. Serial ports
+    // cannot be dropped and ignore this.
+    virtual void disconnectDevice(QIODevice *device) { Q_UNUSED(device); }
+
+signals:
+    // A device is ready for I/O. It stays owned by the transport.
+    void deviceOpened(QIODevice *device);
+    // The device is going away; it is deleted later
+    void deviceClosed(QIODevice *device);
+    void errorOccurred(const QString &error);
+
+private:
+    Kind m_kind;
+    QString m_name;
+    TransportCounters m_counters;
+};
+
+class SerialTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    SerialTransport(const QString &portName, int baudRate, QObject *parent = nullptr);
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override { return m_port != nullptr; }
+    void check() override;
+
+private:
+    void handleError(QSerialPort::SerialPortError error);
+
+    QString m_portName;
+    int m_baudRate;
+    QSerialPort *m_port = nullptr;
+};
+
+// Shared client bookkeeping of the listening transports
+class ServerTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    using Transport::Transport;
+
+    void close() override;
+    void check() override;
+    void disconnectDevice(QIODevice *device) override;
+
+protected:
+    void addClient(QIODevice *client);
+    void removeClient(QIODevice *client);
+    virtual bool isConnected(QIODevice *client) const = 0;
+    virtual void closeServer() = 0;
+    // Flushes and closes, waiting a bounded time for the peer
+    virtual void closeClient(QIODevice *client) = 0;
+    virtual void abortClient(QIODevice *client) = 0;
+
+    QSet<QIODevice *> m_clients;
+};
+
+class TcpTransport : public ServerTransport
+{
+    Q_OBJECT
+
+public:
+    explicit TcpTransport(quint16 port, QObject *parent = nullptr);
+
+    bool open() override;
+    bool isOpen() const override;
+
+protected:
+    bool isConnected(QIODevice *client) const override;
+    void closeServer() override;
+    void closeClient(QIODevice *client) override;
+    void abortClient(QIODevice *client) override;
+
+private:
+    void handleNewConnection();
+
+    quint16 m_port;
+    QTcpServer *m_server;
+};
+
+// Unix domain socket (named pipe on Windows) for co-processes on the same
+// machine, without the TCP loopback overhead
+class LocalTransport : public ServerTransport
+{
+    Q_OBJECT
+
+public:
+    explicit LocalTransport(const QString &serverName, QObject *parent = nullptr);
+
+    bool open() override;
+    bool isOpen() const override;
+
+protected:
+    bool isConnected(QIODevice *client) const override;
+    void closeServer() override;
+    void closeClient(QIODevice *client) override;
+    void abortClient(QIODevice *client) override;
+
+private:
+    void handleNewConnection();
+
+    QString m_serverName;
+    QLocalServer *m_server;
+};
+
+#endif